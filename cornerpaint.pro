@@ -1,7 +1,20 @@
-HEADERS += game.h game_keygrabber.h game_tile.h game_window.h
+HEADERS += game.h game_analysis.h game_keygrabber.h game_pool.h game_repair.h game_session.h game_tile.h game_trace.h game_window.h
 
-SOURCES += game.cc game_keygrabber.cc game_tile.cc game_window.cc game_qt.cc
+SOURCES += game.cc game_analysis.cc game_keygrabber.cc game_pool.cc game_repair.cc game_session.cc game_tile.cc game_trace.cc game_window.cc game_qt.cc
 
-CONFIG += qt c++17 c++1z strict_c++ release
+CONFIG += qt thread c++17 c++1z strict_c++ release
 
 QT += core widgets gui
+
+# Build with "qmake CONFIG+=tracing" to record trace spans (see game_trace.h).
+tracing: DEFINES += LIGHTGAME_TRACING
+
+# game.cc includes the solvability tables for small boards, which are made by
+# a generator program at build time.
+tables_gen.target = game_tables.inc
+tables_gen.depends = $$PWD/game_tables_gen.cc
+tables_gen.commands = $(CXX) -std=c++17 -O2 -o game_tables_gen $$PWD/game_tables_gen.cc && ./game_tables_gen > game_tables.inc
+QMAKE_EXTRA_TARGETS += tables_gen
+PRE_TARGETDEPS += game_tables.inc
+INCLUDEPATH += $$OUT_PWD
+QMAKE_CLEAN += game_tables_gen game_tables.inc
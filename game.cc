@@ -15,6 +15,8 @@
 #include "game.h"
 
 #include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <iostream>
 #include <iterator>
@@ -22,13 +24,22 @@
 #include <utility>
 #include <vector>
 
+#include "game_trace.h"
+
 namespace tkware::lightgame {
+namespace {
+
+// kStartTables[h - 1][w - 1] is the table for boards of height h and width w,
+// indexed by the mask of blocked fields. See Game::LookUpSolvableStarts.
+#include "game_tables.inc"
+
+}  // namespace
 
 Game::Game(int height, int width)
     : height_(height),
       width_(width),
       pos_{0, 0},
-      board_(std::make_unique<State[]>(4 * RawSize())) {
+      board_(std::make_unique<State[]>(3 * RawSize())) {
   for (int x = 0; x != width_ + 2; ++x) {
     At(x, 0) = At(x, height_ + 1) = State::kBlocked;
   }
@@ -63,6 +74,11 @@ bool Game::HaveWon() const {
          board_.get() + RawSize();
 }
 
+bool Game::IsStranded() const {
+  if (!HasStarted()) return false;
+  return PaddedBoard(*this, true).IsStranded(pos_.x + (width_ + 2) * pos_.y);
+}
+
 void Game::Reset() {
   if (HasStarted()) {
     pos_.x = pos_.y = 0;
@@ -162,106 +178,61 @@ void Game::LoadLayoutFromBits(const unsigned char* src, int bits_per_byte) {
   }
 }
 
-bool Game::IsSolvable(std::vector<int>* solutions) {
-  class StateSaver {
-   public:
-    StateSaver(Game* game)
-        : game_(game),
-          pos_(game_->pos_) {
-      game_->CopyBoard(0, 2);
-    }
-
-    ~StateSaver() {
-      game_->CopyBoard(2, 0);
-      game_->pos_ = pos_;
-    }
+bool Game::IsSolvable(std::vector<int>* solutions) const {
+  if (solutions == nullptr) return IsSolvable(nullptr);
+  SolutionSet set;
+  const bool solvable = IsSolvable(&set);
+  set.AppendToLegacy(solutions);
+  return solvable;
+}
 
-   private:
-    Game* game_;
-    Coord pos_;
-  } state_saver(this);
+bool Game::IsSolvable(SolutionSet* solutions) const {
+  std::uint16_t starts;
+  if (solutions == nullptr && LookUpSolvableStarts(&starts)) {
+    return starts != 0;
+  }
 
-  struct Node {
-    Game::Dir value;  // Game:kNone == root node
-    Game::Dir children;
-    int next;
-  };
+  SolutionCursor cursor(*this);
+  if (solutions == nullptr) return cursor.Next(nullptr);
+  bool solvable = false;
+  while (cursor.Next(solutions)) solvable = true;
+  return solvable;
+}
 
-  std::vector<Node> nodes;
-  nodes.reserve(100);
-
-  auto solve_one = [this, &nodes, solutions](int x, int y) -> bool {
-    Reset();
-    if (!Start(x, y)) return false;
-
-    nodes.clear();
-    nodes.push_back(Node{Game::kNone, ValidDirs(), 0});
-
-    while (!nodes.empty()) {
-      Node& node = nodes.back();
-      if (node.children == Game::kNone) {
-        if (HaveWon()) {
-          if (solutions != nullptr) {
-            solutions->push_back(x);
-            solutions->push_back(y);
-            for (auto it = std::next(nodes.cbegin()); it != nodes.cend(); ++it) {
-              solutions->push_back(it->value);
-            }
-            solutions->push_back(0);
-          }
-          return true;
-        } else {
-          nodes.pop_back();
-        }
-      } else if (node.next == 4) {
-        nodes.pop_back();
-      } else {
-        auto dir = Game::Dir(1 << node.next);
-        ++node.next;
-        if ((node.children & dir) != dir) continue;
-
-        Reset();
-        // Replay the action stack.
-        if (!(Start(x, y))) {
-          std::cerr << "Bad start!\n";
-          abort();
-        }
-        for (auto it = std::next(nodes.cbegin()); it != nodes.cend(); ++it) {
-          if (!MoveFast(it->value)) {
-            std::cerr << "Bad replay.\n";
-            abort();
-          }
-        }
-        // Perform the next candidate move.
-        if (!MoveFast(dir)) {
-          std::cerr << "Bad replay.\n";
-          abort();
-        }
-        // Record the result.
-        nodes.push_back(Node{dir, ValidDirs(), 0});
-      }
-    }
+bool Game::LookUpSolvableStarts(std::uint16_t* starts) const {
+  if (height_ < 1 || height_ > kMaxTableSize || width_ < 1 ||
+      width_ > kMaxTableSize) {
     return false;
-  };
-
-  int num_solutions = 0;
-
-  for (int y = 1; y <= Height(); ++y) {
-    for (int x = 1; x <= Width(); ++x) {
-      if (solve_one(x, y)) {
-        if (solutions == nullptr) {
-          return true;
-        } else {
-          ++num_solutions;
-        }
-      }
+  }
+  const State* layout = Layout();
+  unsigned int blocked = 0;
+  for (int i = 0; i != height_ * width_; ++i) {
+    if (layout[i % width_ + 1 + (width_ + 2) * (i / width_ + 1)] ==
+        State::kBlocked) {
+      blocked |= 1U << i;
     }
   }
-
-  return num_solutions > 0;
+  *starts = kStartTables[height_ - 1][width_ - 1][blocked];
+  return true;
 }
 
 bool Game::AugmentRandomly(int n, std::mt19937* rbg) {
+  SolutionSet solutions;
+  if (!AugmentRandomly(n, rbg, [] { return false; }, &solutions)) {
+    return false;
+  }
+
+  std::cout << "It worked! [[" << SaveToHexString(*this) << "]]:\n";
+  for (const SolutionSet::Solution& solution : solutions) {
+    std::cout << "- from [REDACTED] move [ " << solution.size()
+              << " times ]\n";
+  }
+  return true;
+}
+
+bool Game::AugmentRandomly(int n, std::mt19937* rbg,
+                           const std::function<bool()>& should_stop,
+                           SolutionSet* solutions) {
   if (HasStarted()) {
     std::cout << "Game has already started!\n";
     return false;
@@ -280,26 +251,24 @@ bool Game::AugmentRandomly(int n, std::mt19937* rbg) {
   }
 
   // Backup copy of the original layout.
-  CopyBoard(0, 3);
+  CopyBoard(0, 2);
   std::unique_ptr<State[]> p = std::make_unique<State[]>(num_free);
   std::fill_n(p.get(), n, State::kBlocked);
-  std::vector<int> solutions;
 
   for (;;) {
+    LIGHTGAME_TRACE_SCOPE("AugmentRandomly attempt");
+    if (should_stop()) {
+      CopyBoard(2, 0);
+      return false;
+    }
     std::shuffle(p.get(), p.get() + num_free, *rbg);
-    CopyBoard(3, 0);
+    CopyBoard(2, 0);
     for (int i = 0, k = 0; i != num_free; ++i) {
       while (board_[k] != State::kOff) ++k;
       board_[k] = p[i];
       ++k;
     }
-    if (IsSolvable(&solutions)) {
-      std::cout << "It worked! [[" << SaveToHexString(*this) << "]]:\n";
-      for (auto it = solutions.begin(); it != solutions.end(); ++it) {
-        ++it; ++it; int n = 0; while (*it != 0) ++it, ++n;
-        std::cout << "- from [REDACTED] move [ " << n << " times ]\n";
-      }
-
+    if (IsSolvable(solutions)) {
       CopyBoard(0, 1);
       return true;
     }
@@ -347,29 +316,207 @@ std::unique_ptr<Game> LoadFromHexString(std::string code) {
   return game;
 }
 
-void SolutionTracker::RecomputeFromGame(Game* game) {
-  raw_solution_.clear();
-  solutions_.clear();
-  if (game->IsSolvable(&raw_solution_)) {
-    for (auto it = raw_solution_.begin(); it != raw_solution_.end(); ++it) {
-      solutions_.push_back({{*it++, *it++}, false});
-      while (*it != 0) ++it;
+void SolutionSet::Add(Game::Coord start) {
+  starts_.push_back({static_cast<std::uint16_t>(start.x),
+                     static_cast<std::uint16_t>(start.y),
+                     static_cast<std::uint32_t>(num_moves_)});
+}
+
+void SolutionSet::AddMove(Game::Dir dir) {
+  if (num_moves_ % 4 == 0) moves_.push_back(0);
+  moves_.back() |= __builtin_ctz(dir) << (2 * (num_moves_ % 4));
+  ++num_moves_;
+}
+
+void SolutionSet::clear() {
+  starts_.clear();
+  moves_.clear();
+  num_moves_ = 0;
+}
+
+bool SolutionSet::AppendFromLegacy(const int* begin, const int* end) {
+  const std::size_t num_starts = starts_.size(), num_moves = num_moves_;
+  auto fail = [&] {
+    starts_.resize(num_starts);
+    num_moves_ = num_moves;
+    moves_.resize((num_moves + 3) / 4);
+    if (num_moves % 4 != 0) {
+      moves_.back() &= (1U << (2 * (num_moves % 4))) - 1;
+    }
+    return false;
+  };
+
+  for (const int* it = begin; it != end; ++it) {
+    if (end - it < 3 || it[0] < 1 || it[0] > 0xFFFF || it[1] < 1 ||
+        it[1] > 0xFFFF) {
+      return fail();
+    }
+    Add({it[0], it[1]});
+    for (it += 2; *it != 0; ++it) {
+      if (*it != Game::kUp && *it != Game::kDown && *it != Game::kLeft &&
+          *it != Game::kRight) {
+        return fail();
+      }
+      AddMove(Game::Dir(*it));
+      if (it + 1 == end) return fail();
     }
   }
+  return true;
 }
 
-bool SolutionTracker::ReportSolution(Game::Coord start_pos) {
-  auto find_pos = [](Game::Coord pos) {
-    return [pos](const Solution& sol) { return sol.start_pos == pos; };
-  };
+void SolutionSet::AppendToLegacy(std::vector<int>* out) const {
+  out->reserve(out->size() + 3 * size() + num_moves_);
+  for (const Solution& solution : *this) {
+    out->push_back(solution.Start().x);
+    out->push_back(solution.Start().y);
+    out->insert(out->end(), solution.begin(), solution.end());
+    out->push_back(0);
+  }
+}
+
+PaddedBoard::PaddedBoard(const Game& game, bool live)
+    : offsets_{-(game.Width() + 2), +(game.Width() + 2), -1, +1} {
+  const Game::State* const board = live ? game.board_.get() : game.Layout();
+  fields_.assign(board, board + game.RawSize());
+  num_off_ = std::count(fields_.begin(), fields_.end(), Game::State::kOff);
+}
+
+unsigned int PaddedBoard::ValidDirs(int i) const {
+  unsigned int dirs = 0;
+  for (int d = 0; d != 4; ++d) {
+    if (IsOff(i + offsets_[d])) dirs |= 1U << d;
+  }
+  return dirs;
+}
+
+bool PaddedBoard::IsStranded(int here) {
+  // Flood-fill the "off" fields reachable from the active field, counting the
+  // dead ends among them along the way. The first half of the scratch space
+  // marks visited fields, the second half is the stack.
+  scratch_.assign(2 * fields_.size(), 0);
+  int* const seen = scratch_.data();
+  int* const stack = seen + fields_.size();
+  int top = 0, num_reached = 0, num_dead_ends = 0;
+  stack[top++] = here;
+  seen[here] = 1;
+  while (top != 0) {
+    const int i = stack[--top];
+    int num_free = 0;
+    for (int d : offsets_) {
+      const int j = i + d;
+      const bool off = IsOff(j);
+      num_free += off || j == here;
+      if (off && !seen[j]) {
+        seen[j] = 1;
+        ++num_reached;
+        stack[top++] = j;
+      }
+    }
+    if (i != here && num_free <= 1 && ++num_dead_ends > 1) return true;
+  }
+
+  // Any "off" fields not reached are cut off.
+  return num_reached != num_off_;
+}
+
+int PaddedBoard::MoveFast(int i, int d) {
+  for (;;) {
+    while (IsOff(i + offsets_[d])) {
+      i += offsets_[d];
+      fields_[i] = Game::State::kOn;
+      --num_off_;
+      trail_.push_back(i);
+    }
+    const unsigned int dirs = ValidDirs(i);
+    if (dirs == 0 || (dirs & (dirs - 1)) != 0) return i;
+    d = __builtin_ctz(dirs);
+  }
+}
+
+SolutionCursor::SolutionCursor(const Game& game)
+    : game_(game), stride_(game.Width() + 2), board_(game) {
+  nodes_.reserve(100);
+}
+
+SolutionCursor::Progress SolutionCursor::Advance(SolutionSet* solutions,
+                                                 std::size_t max_actions) {
+  LIGHTGAME_TRACE_SCOPE("SolutionCursor::Advance");
+  const int end = stride_ * (game_.Height() + 1);
+  for (std::size_t num_actions = 0;;) {
+    if (nodes_.empty()) {
+      // Moves on to the next start field. Only the first solution from each
+      // start is reported, so the search from a start ends with its first
+      // win.
+      do {
+        if (++start_ >= end) return Progress::kDone;
+      } while (!board_.IsOff(start_));
+      board_.Start(start_);
+      nodes_.push_back(Node{start_, board_.Children(start_), 0, -1});
+    }
+
+    // The search from one start. If it pauses, the next call resumes it
+    // under a new span.
+    LIGHTGAME_TRACE_SCOPE("IsSolvable start");
+    for (;;) {
+      Node& node = nodes_.back();
+      if (node.children != 0) {
+        if (num_actions++ == max_actions) return Progress::kPaused;
+        const int d = __builtin_ctz(node.children);
+        node.children &= node.children - 1;
+        const std::size_t length = board_.TrailSize();
+        const int pos = board_.MoveFast(node.pos, d);
+        nodes_.push_back(Node{pos, board_.Children(pos), length, d});
+        continue;
+      }
+
+      const bool won = board_.NumOff() == 0;
+      if (won && solutions != nullptr) {
+        solutions->Add({start_ % stride_, start_ / stride_});
+        for (auto it = std::next(nodes_.cbegin()); it != nodes_.cend(); ++it) {
+          solutions->AddMove(Game::Dir(1 << it->dir));
+        }
+      }
+      board_.Undo(won ? 0 : node.trail);
+      if (won) {
+        nodes_.clear();
+      } else {
+        nodes_.pop_back();
+      }
+      if (nodes_.empty()) {
+        if (won) return Progress::kFound;
+        break;
+      }
+    }
+  }
+}
 
-  if (auto it = std::find_if(solutions_.begin(), solutions_.end(),
-                             find_pos(start_pos));
-      it != solutions_.end()) {
-    return !std::exchange(it->found, true);
+void SolutionTracker::RecomputeFromGame(const Game* game) {
+  solutions_.clear();
+  std::uint16_t starts;
+  if (game->LookUpSolvableStarts(&starts)) {
+    for (; starts != 0; starts &= starts - 1) {
+      const int i = __builtin_ctz(starts);
+      solutions_.push_back({i % game->Width() + 1, i / game->Width() + 1});
+    }
   } else {
-    return false;
+    SolutionSet solutions;
+    game->IsSolvable(&solutions);
+    for (const SolutionSet::Solution& solution : solutions) {
+      solutions_.push_back(solution.Start());
+    }
+  }
+  found_.assign(solutions_.size(), false);
+}
+
+bool SolutionTracker::ReportSolution(Game::Coord start_pos) {
+  for (std::size_t i = 0; i != solutions_.size(); ++i) {
+    if (solutions_[i] == start_pos) {
+      const bool novel = !found_[i];
+      found_[i] = true;
+      return novel;
+    }
   }
+  return false;
 }
 
 std::size_t SolutionTracker::TotalCount() const {
@@ -377,14 +524,13 @@ std::size_t SolutionTracker::TotalCount() const {
 }
 
 std::size_t SolutionTracker::FoundCount() const {
-  return std::count_if(solutions_.begin(), solutions_.end(),
-                       std::mem_fn(&Solution::found));
+  return std::count(found_.begin(), found_.end(), true);
 }
 
 std::vector<Game::Coord> SolutionTracker::FoundSolutions() const {
   std::vector<Game::Coord> result;
-  for (const Solution& solution : solutions_) {
-    if (solution.found) { result.push_back(solution.start_pos); }
+  for (std::size_t i = 0; i != solutions_.size(); ++i) {
+    if (found_[i]) { result.push_back(solutions_[i]); }
   }
   return result;
 }
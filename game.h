@@ -16,7 +16,10 @@
 #define H_TKWARE_LIGHTGAME_GAME_
 
 #include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <iterator>
 #include <memory>
 #include <random>
 #include <string>
@@ -24,6 +27,10 @@
 
 namespace tkware::lightgame {
 
+class PaddedBoard;
+class SolutionCursor;
+class SolutionSet;
+
 // A board of size Height × Width. Valid coordinates are x ∈ [1, Width] and
 // y ∈ [1, Height], but one extra field of blocked padding is stored around
 // the board, so internally, valid indices lie in [0, {H, W} + 1].
@@ -86,11 +93,37 @@ class Game {
   // Returns whether the game is in the win state (no "off" fields left).
   bool HaveWon() const;
 
+  // Returns whether the game in progress can provably no longer be won. This is
+  // a cheap structural check: the game is stranded if some "off" field is no
+  // longer connected to the active field through "off" fields, or if more than
+  // one "off" field is a dead end (has at most one free neighbour, counting the
+  // active field), since the path would have to end on each of them. A false
+  // result does not imply that the game can still be won. Returns false if no
+  // game is in progress.
+  bool IsStranded() const;
+
   // Returns whether the game is winnable in principle (ignoring its current
   // state if the game is already in progress). If solutions is not null, all
   // possible solutions are appended to *solutions consecutively in the format
   // "x, y, a_1, a_2, ..., a_N, 0", where the a_i are Dir-valued fast actions.
-  bool IsSolvable(std::vector<int>* solutions);
+  // The SolutionSet version appends the same solutions in compact form. The
+  // search runs on its own scratch copy of the layout, so it does not modify
+  // the game, and it may be called from several threads at once (as long as
+  // none of them modifies the game).
+  bool IsSolvable(std::vector<int>* solutions) const;
+  bool IsSolvable(SolutionSet* solutions) const;
+  bool IsSolvable(std::nullptr_t) const {
+    return IsSolvable(static_cast<SolutionSet*>(nullptr));
+  }
+
+  // For boards of at most 4 × 4 fields, the fields from which the game can be
+  // won are precomputed for every layout at build time (by game_tables_gen).
+  // If the board is that small, sets *starts to the mask of those fields of
+  // the layout (ignoring any game in progress), in which bit
+  // x - 1 + Width * (y - 1) stands for field (x, y), and returns true.
+  // Otherwise returns false. IsSolvable(nullptr) and SolutionTracker use this
+  // lookup instead of a search where they can.
+  bool LookUpSolvableStarts(std::uint16_t* starts) const;
 
   // Resets the game; after this call, the game is no longer in progress and all
   // fields are either "off" or "blocked".
@@ -154,17 +187,33 @@ class Game {
   // progress or n is too large or too small.
   bool AugmentRandomly(int n, std::mt19937* rbg);
 
+  // As above, but does not print the result, and gives up as soon as
+  // should_stop returns true (it is polled before each attempt), in which case
+  // the layout is left unchanged and false is returned. If solutions is not
+  // null, the solutions of the new layout are appended to *solutions.
+  bool AugmentRandomly(int n, std::mt19937* rbg,
+                       const std::function<bool()>& should_stop,
+                       SolutionSet* solutions = nullptr);
+
 private:
+  friend class PaddedBoard;
+  friend class SolutionCursor;
+
   int RawSize() const { return (height_ + 2) * (width_ + 2); }
 
-  // We store four copies of the board:
+  // We store three copies of the board:
   // * Area 0: the live board for the active game.
   // * Area 1: a copy of just the layout (e.g. used for reset).
-  // * Area 2: backup copy of the live game, for the solver.
   // * Area 2: backup copy of the layout, for layout augmentation.
   // Valid from, to parameters are 0, 1, 2, subject to from != to.
   void CopyBoard(int from, int to);
 
+  // Returns the layout: area 1 while a game is in progress, and area 0
+  // otherwise.
+  const State* Layout() const {
+    return board_.get() + (HasStarted() ? RawSize() : 0);
+  }
+
   // Moves in the given direction.
   void MoveOne(Dir dir, Path* path);
 
@@ -174,6 +223,259 @@ private:
   const std::unique_ptr<State[]> board_;
 };
 
+// A list of solutions, as found by Game::IsSolvable, in compact form: each
+// solution is a start field and a sequence of fast actions, and each action
+// takes up two bits (rather than an int, as in the legacy format
+// "x, y, a_1, a_2, ..., a_N, 0"). Solutions and their actions are accessed
+// through lightweight views into the set, which remain valid until the set is
+// next modified.
+class SolutionSet {
+ public:
+  // A view of the actions of one solution, as Dir values.
+  class Solution {
+   public:
+    class iterator {
+     public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = Game::Dir;
+      using difference_type = std::ptrdiff_t;
+      using pointer = void;
+      using reference = Game::Dir;
+
+      iterator() = default;
+
+      Game::Dir operator*() const { return SolutionSet::Decode(moves_, i_); }
+      iterator& operator++() { ++i_; return *this; }
+      iterator operator++(int) { iterator it = *this; ++i_; return it; }
+
+      friend bool operator==(const iterator& lhs, const iterator& rhs) {
+        return lhs.i_ == rhs.i_;
+      }
+      friend bool operator!=(const iterator& lhs, const iterator& rhs) {
+        return lhs.i_ != rhs.i_;
+      }
+
+     private:
+      friend class Solution;
+      iterator(const std::uint8_t* moves, std::size_t i)
+          : moves_(moves), i_(i) {}
+
+      const std::uint8_t* moves_ = nullptr;
+      std::size_t i_ = 0;
+    };
+
+    Game::Coord Start() const { return start_; }
+    std::size_t size() const { return end_ - begin_; }
+    bool empty() const { return begin_ == end_; }
+
+    Game::Dir operator[](std::size_t i) const {
+      return SolutionSet::Decode(moves_, begin_ + i);
+    }
+
+    iterator begin() const { return iterator(moves_, begin_); }
+    iterator end() const { return iterator(moves_, end_); }
+
+   private:
+    friend class SolutionSet;
+    Solution(Game::Coord start, const std::uint8_t* moves, std::size_t begin,
+             std::size_t end)
+        : start_(start), moves_(moves), begin_(begin), end_(end) {}
+
+    Game::Coord start_;
+    const std::uint8_t* moves_;
+    std::size_t begin_, end_;
+  };
+
+  class iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Solution;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = Solution;
+
+    iterator() = default;
+
+    Solution operator*() const { return (*set_)[i_]; }
+    iterator& operator++() { ++i_; return *this; }
+    iterator operator++(int) { iterator it = *this; ++i_; return it; }
+
+    friend bool operator==(const iterator& lhs, const iterator& rhs) {
+      return lhs.i_ == rhs.i_;
+    }
+    friend bool operator!=(const iterator& lhs, const iterator& rhs) {
+      return lhs.i_ != rhs.i_;
+    }
+
+   private:
+    friend class SolutionSet;
+    iterator(const SolutionSet* set, std::size_t i) : set_(set), i_(i) {}
+
+    const SolutionSet* set_ = nullptr;
+    std::size_t i_ = 0;
+  };
+
+  std::size_t size() const { return starts_.size(); }
+  bool empty() const { return starts_.empty(); }
+
+  Solution operator[](std::size_t i) const {
+    return Solution({starts_[i].x, starts_[i].y}, moves_.data(),
+                    starts_[i].begin,
+                    i + 1 == starts_.size() ? num_moves_ : starts_[i + 1].begin);
+  }
+
+  iterator begin() const { return iterator(this, 0); }
+  iterator end() const { return iterator(this, size()); }
+
+  // Starts a new solution at the given field; subsequent actions are added to
+  // it with AddMove. The coordinates must lie in [1, 65535].
+  void Add(Game::Coord start);
+
+  // Appends an action (one of kUp, kDown, kLeft, kRight) to the last solution.
+  void AddMove(Game::Dir dir);
+
+  void clear();
+
+  // Conversion from and to the legacy format. AppendFromLegacy appends the
+  // solutions in [begin, end), and returns false (and leaves the set
+  // unchanged) if the input is malformed. AppendToLegacy appends all
+  // solutions to *out.
+  bool AppendFromLegacy(const int* begin, const int* end);
+  bool AppendFromLegacy(const std::vector<int>& legacy) {
+    return AppendFromLegacy(legacy.data(), legacy.data() + legacy.size());
+  }
+  void AppendToLegacy(std::vector<int>* out) const;
+
+  // Returns the number of bytes of storage in use (not counting the object
+  // itself or any unused capacity).
+  std::size_t ByteSize() const {
+    return starts_.size() * sizeof(Entry) + moves_.size();
+  }
+
+ private:
+  struct Entry {
+    std::uint16_t x, y;
+    std::uint32_t begin;  // the index of the first action
+  };
+
+  // Action i is stored in bits 2 * (i % 4) and up of byte i / 4, as the
+  // exponent of the Dir value (kUp = 0, kDown = 1, kLeft = 2, kRight = 3).
+  static Game::Dir Decode(const std::uint8_t* moves, std::size_t i) {
+    return Game::Dir(1 << ((moves[i / 4] >> (2 * (i % 4))) & 3));
+  }
+
+  std::vector<Entry> starts_;
+  std::vector<std::uint8_t> moves_;
+  std::size_t num_moves_ = 0;
+};
+
+// A scratch copy of a board, with its padding, on which the solvers search
+// without touching the game: fast actions switch fields "on" and record them
+// on a trail, from which they are undone again. Fields are indices into the
+// padded board (x + (width + 2) * y), and directions are the indices 0 to 3
+// of kUp, kDown, kLeft and kRight.
+class PaddedBoard {
+ public:
+  // Copies the live board of game if live is true and a game is in progress,
+  // and the layout otherwise.
+  explicit PaddedBoard(const Game& game, bool live = false);
+
+  int Offset(int d) const { return offsets_[d]; }
+  std::size_t Size() const { return fields_.size(); }
+  bool IsOff(int i) const { return fields_[i] == Game::State::kOff; }
+  bool IsOn(int i) const { return fields_[i] == Game::State::kOn; }
+  int NumOff() const { return num_off_; }
+
+  // Returns the directions from field i that lead to an "off" field, as a
+  // bit set of direction indices.
+  unsigned int ValidDirs(int i) const;
+
+  // As Game::IsStranded, for the active field i.
+  bool IsStranded(int i);
+
+  // Returns the directions that are worth trying from the active field i:
+  // none if it is stranded. (Fields without valid directions are leaves
+  // anyway and need no check.)
+  unsigned int Children(int i) {
+    const unsigned int dirs = ValidDirs(i);
+    return dirs != 0 && IsStranded(i) ? 0U : dirs;
+  }
+
+  // Switches the "off" field i "on" as a start.
+  void Start(int i) {
+    fields_[i] = Game::State::kOn;
+    --num_off_;
+    trail_.push_back(i);
+  }
+
+  // As Game::MoveFast from the active field i in direction d, which must lead
+  // to an "off" field. Returns the new active field.
+  int MoveFast(int i, int d);
+
+  // Switches the fields on the trail beyond the given length back "off".
+  std::size_t TrailSize() const { return trail_.size(); }
+  void Undo(std::size_t length) {
+    for (; trail_.size() != length; trail_.pop_back()) {
+      fields_[trail_.back()] = Game::State::kOff;
+      ++num_off_;
+    }
+  }
+
+ private:
+  int offsets_[4];
+  std::vector<Game::State> fields_;
+  int num_off_;
+  std::vector<int> trail_;
+  std::vector<int> scratch_;
+};
+
+// Enumerates the solutions of a layout lazily, in the order of
+// Game::IsSolvable (which just runs a cursor to the end). Each call searches
+// only up to the next solution and keeps the search state in between, so a
+// caller that needs only the first few solutions, or that wants to show them
+// as they are found, does not pay for the rest. A cursor may be abandoned at
+// any point.
+class SolutionCursor {
+ public:
+  enum class Progress {
+    kFound,   // a solution was found and appended
+    kPaused,  // the budget of actions ran out; the search can be resumed
+    kDone,    // all starts have been searched
+  };
+
+  // Enumerates the solutions of the layout of game (ignoring any game in
+  // progress). The game must outlive the cursor.
+  explicit SolutionCursor(const Game& game);
+
+  // Searches for the next solution and appends it to *solutions (if not
+  // null). Returns false once there are no more solutions.
+  bool Next(SolutionSet* solutions) {
+    return Advance(solutions, static_cast<std::size_t>(-1)) ==
+           Progress::kFound;
+  }
+
+  // As Next, but pauses once the search has made max_actions fast actions,
+  // so that a caller (such as an event loop) can spread the search out.
+  Progress Advance(SolutionSet* solutions, std::size_t max_actions);
+
+ private:
+  struct Node {
+    int pos;
+    unsigned int children;  // the directions that are yet to be tried
+    std::size_t trail;      // the length of the trail before the action
+    int dir;                // the index of the action, or -1 for the start
+  };
+
+  const Game& game_;
+  const int stride_;
+
+  // The search runs on a scratch copy of the layout, so that the game itself
+  // is never touched.
+  PaddedBoard board_;
+  int start_ = 0;  // the index of the current start, or of the last one tried
+  std::vector<Node> nodes_;
+};
+
 // Serialization as 4-bit (hex) strings. Loading returns null on error.
 std::string SaveToHexString(const Game& game);
 std::unique_ptr<Game> LoadFromHexString(std::string code);
@@ -183,17 +485,22 @@ std::unique_ptr<Game> LoadFromHexString(std::string code);
 // echoes that function's behaviour: solutions consist only of a starting
 // point, and not of the complete action sequence (because the solver does not
 // explore multiple solving paths), and solutions are sequenced in the order
-// in which the solver reports them.
+// in which the solver reports them (which is row-major order).
 class SolutionTracker {
  public:
-  // Runs the solver for *game, and sets all possible solutions to "not found".
-  void RecomputeFromGame(Game* game);
+  // Runs the solver for *game (or looks up the solvable starts, for small
+  // boards), and sets all possible solutions to "not found".
+  void RecomputeFromGame(const Game* game);
 
   // Reports "start_pos" as a found solution. Returns whether the solution was
   // novel, i.e. has not previously been reported. Requires that start_pos is
   // actually a solution.
   bool ReportSolution(Game::Coord start_pos);
 
+  // Returns the starts of all possible solutions, in the order in which the
+  // solver reports them.
+  const std::vector<Game::Coord>& AllSolutions() const { return solutions_; }
+
   // Returns the counts of, respectively, all possible solutions and the found
   // solutions.
   std::size_t TotalCount() const;
@@ -204,9 +511,8 @@ class SolutionTracker {
   std::vector<Game::Coord> FoundSolutions() const;
 
  private:
-  struct Solution { Game::Coord start_pos; bool found; };
-  std::vector<int> raw_solution_;
-  std::vector<Solution> solutions_;
+  std::vector<Game::Coord> solutions_;
+  std::vector<bool> found_;
 };
 
 }  //  namespace tkware::lightgame
@@ -0,0 +1,128 @@
+// Copyright 2019 by Thomas Köppe
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "game_analysis.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "game.h"
+
+namespace tkware::lightgame {
+namespace {
+
+constexpr Game::Dir kDirs[] = {Game::kUp, Game::kDown, Game::kLeft,
+                               Game::kRight};
+
+}  // namespace
+
+LiveAnalysis LiveAnalyzer::Analyze(const Game& game, std::size_t max_nodes,
+                                   const std::function<bool()>& should_stop) {
+  if (!game.HasStarted()) return {false, Game::kNone};
+
+  LoadLayout(game);
+  board_.emplace(game, true);
+  if (board_->NumOff() == 0) return {true, Game::kNone};
+
+  num_nodes_ = 0;
+  max_nodes_ = max_nodes;
+  should_stop_ = &should_stop;
+  cut_short_ = false;
+
+  const int pos = game.X() + (width_ + 2) * game.Y();
+  LiveAnalysis result = {false, Game::kNone};
+  for (int d = 0; d != 4; ++d) {
+    if (!board_->IsOff(pos + board_->Offset(d))) continue;
+    if (IsWinnable(board_->MoveFast(pos, d))) {
+      result.winnable = true;
+      result.winning_dirs |= kDirs[d];
+    }
+    board_->Undo(0);
+  }
+  result.known = !cut_short_;
+  should_stop_ = nullptr;
+  return result;
+}
+
+void LiveAnalyzer::LoadLayout(const Game& game) {
+  std::vector<unsigned char> layout(game.LayoutByteSize(8));
+  game.WriteLayoutAsBits(layout.data(), 8);
+  if (game.Height() == height_ && game.Width() == width_ &&
+      layout == layout_) {
+    return;
+  }
+
+  height_ = game.Height();
+  width_ = game.Width();
+  layout_ = std::move(layout);
+  key_words_ = ((height_ + 2) * (width_ + 2) + 63) / 64 + 1;
+  key_.assign(key_words_, 0);
+  memo_.clear();
+  memo_keys_.clear();
+  memo_results_.clear();
+}
+
+void LiveAnalyzer::WriteKey(int pos, std::uint64_t* key) const {
+  std::fill(key, key + key_words_, 0);
+  for (std::size_t i = 0; i != board_->Size(); ++i) {
+    key[i / 64] |= std::uint64_t{board_->IsOn(i)} << (i % 64);
+  }
+  key[key_words_ - 1] = pos;
+}
+
+bool LiveAnalyzer::IsWinnable(int pos) {
+  if (board_->NumOff() == 0) return true;
+  if (board_->IsStranded(pos)) return false;
+
+  WriteKey(pos, key_.data());
+  std::uint64_t hash = 0;
+  for (std::uint64_t word : key_) hash = (hash ^ word) * 0x9E3779B97F4A7C15;
+  if (auto it = memo_.find(hash); it != memo_.end() &&
+      std::equal(key_.begin(), key_.end(),
+                 memo_keys_.begin() + it->second * key_words_)) {
+    return memo_results_[it->second];
+  }
+
+  if (num_nodes_ == max_nodes_ ||
+      (num_nodes_++ % 1024 == 0 && (*should_stop_)())) {
+    cut_short_ = true;
+  }
+  bool winnable = false;
+  for (int d = 0; d != 4 && !winnable && !cut_short_; ++d) {
+    if (!board_->IsOff(pos + board_->Offset(d))) continue;
+    const std::size_t n = board_->TrailSize();
+    winnable = IsWinnable(board_->MoveFast(pos, d));
+    board_->Undo(n);
+  }
+
+  // A search that was cut short has only found out about wins.
+  if (cut_short_ && !winnable) return false;
+  if (memo_.size() >= max_memo_size_) {
+    memo_.clear();
+    memo_keys_.clear();
+    memo_results_.clear();
+  }
+  if (memo_.try_emplace(hash, memo_results_.size()).second) {
+    memo_keys_.resize(memo_keys_.size() + key_words_);
+    WriteKey(pos, &*(memo_keys_.end() - key_words_));
+    memo_results_.push_back(winnable);
+  }
+  return winnable;
+}
+
+}  //  namespace tkware::lightgame
@@ -0,0 +1,102 @@
+// Copyright 2019 by Thomas Köppe
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef H_TKWARE_LIGHTGAME_GAME_ANALYSIS_
+#define H_TKWARE_LIGHTGAME_GAME_ANALYSIS_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "game.h"
+
+namespace tkware::lightgame {
+
+struct LiveAnalysis {
+  // Whether the game in progress can still be won.
+  bool winnable;
+
+  // The valid directions after which the game can still be won; kNone if the
+  // game cannot be won, or if it is already over.
+  Game::Dir winning_dirs;
+
+  // False if the search was cut short; then winnable and winning_dirs only
+  // report the wins that were found, and a game that is not winnable may
+  // still be winnable after all.
+  bool known = true;
+};
+
+// Analyses games in progress: unlike Game::IsSolvable, which solves the
+// layout from every start, this searches only the continuations of the live
+// board from the active field. The result of every position that is searched
+// (the set of "on" fields and the active field) is remembered, so that after
+// a move, the next analysis of the same game mostly finds its answers in the
+// part of the search tree that was already explored. The memory is cleared
+// when the layout changes, or when it grows beyond max_memo_size entries.
+class LiveAnalyzer {
+ public:
+  explicit LiveAnalyzer(std::size_t max_memo_size = 1 << 20)
+      : max_memo_size_(max_memo_size) {}
+
+  // Analyses the game in progress. Returns {false, kNone} if no game is in
+  // progress. The search gives up, and reports that the result is not known,
+  // once it has searched max_nodes positions that were not remembered, or
+  // once should_stop returns true (which is polled every 1024 of those).
+  LiveAnalysis Analyze(
+      const Game& game, std::size_t max_nodes = -1,
+      const std::function<bool()>& should_stop = [] { return false; });
+
+  // The number of remembered positions.
+  std::size_t MemoSize() const { return memo_.size(); }
+
+ private:
+  void LoadLayout(const Game& game);
+
+  // Writes the key of the current position, i.e. the set of "on" fields (one
+  // bit each) and the active field, to key_words_ words at key.
+  void WriteKey(int pos, std::uint64_t* key) const;
+
+  // Returns whether the game can be won from the active field pos, or false
+  // once the search is cut short.
+  bool IsWinnable(int pos);
+
+  const std::size_t max_memo_size_;
+
+  int height_ = 0;
+  int width_ = 0;
+  std::vector<unsigned char> layout_;
+  std::optional<PaddedBoard> board_;  // the live board during Analyze
+
+  std::size_t num_nodes_ = 0;
+  std::size_t max_nodes_ = 0;
+  const std::function<bool()>* should_stop_ = nullptr;
+  bool cut_short_ = false;
+
+  // The remembered results. memo_ maps the hash of a key to the number of its
+  // entry; the keys of the entries are stored one after another in
+  // memo_keys_, and their results in memo_results_. A key whose hash is
+  // already taken by another key is not remembered.
+  std::size_t key_words_ = 0;
+  std::vector<std::uint64_t> key_;
+  std::unordered_map<std::uint64_t, std::uint32_t> memo_;
+  std::vector<std::uint64_t> memo_keys_;
+  std::vector<unsigned char> memo_results_;
+};
+
+}  //  namespace tkware::lightgame
+
+#endif  // H_TKWARE_LIGHTGAME_GAME_ANALYSIS_
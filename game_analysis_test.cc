@@ -0,0 +1,183 @@
+#include "game_analysis.h"
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "game.h"
+#include "gtest/gtest.h"
+
+namespace tkware::lightgame {
+namespace {
+
+// Replays the fast actions from the given start on a fresh copy of the
+// layout.
+std::unique_ptr<Game> Replay(const std::string& code, Game::Coord start,
+                             const std::vector<Game::Dir>& moves) {
+  std::unique_ptr<Game> game = LoadFromHexString(code);
+  EXPECT_TRUE(game->Start(start.x, start.y));
+  for (Game::Dir dir : moves) EXPECT_TRUE(game->MoveFast(dir));
+  return game;
+}
+
+// Exhaustive search by replaying every continuation.
+bool BruteForceWinnable(const std::string& code, Game::Coord start,
+                        std::vector<Game::Dir>* moves) {
+  std::unique_ptr<Game> game = Replay(code, start, *moves);
+  if (game->HaveWon()) return true;
+  const Game::Dir dirs = game->ValidDirs();
+  for (Game::Dir dir : {Game::kUp, Game::kDown, Game::kLeft, Game::kRight}) {
+    if ((dirs & dir) == 0) continue;
+    moves->push_back(dir);
+    const bool winnable = BruteForceWinnable(code, start, moves);
+    moves->pop_back();
+    if (winnable) return true;
+  }
+  return false;
+}
+
+TEST(LiveAnalyzer, NotStarted) {
+  Game game(2, 3);
+  LiveAnalyzer analyzer;
+  const LiveAnalysis analysis = analyzer.Analyze(game);
+  EXPECT_FALSE(analysis.winnable);
+  EXPECT_EQ(analysis.winning_dirs, Game::kNone);
+}
+
+TEST(LiveAnalyzer, SmallGame) {
+  // +--+--+--+
+  // |  |St|  |
+  // +--+--+--+
+  // |  |  |  |
+  // +--+--+--+
+  Game game(2, 3);
+  LiveAnalyzer analyzer;
+  ASSERT_TRUE(game.Start(2, 1));
+  LiveAnalysis analysis = analyzer.Analyze(game);
+  EXPECT_TRUE(analysis.winnable);
+  EXPECT_EQ(analysis.winning_dirs, Game::kLeft | Game::kRight);
+
+  ASSERT_TRUE(game.Move(Game::kDown));
+  analysis = analyzer.Analyze(game);
+  EXPECT_FALSE(analysis.winnable);
+  EXPECT_EQ(analysis.winning_dirs, Game::kNone);
+
+  game.Reset();
+  ASSERT_TRUE(game.Start(1, 1));
+  ASSERT_TRUE(game.MoveFast(Game::kRight));
+  EXPECT_TRUE(game.HaveWon());
+  analysis = analyzer.Analyze(game);
+  EXPECT_TRUE(analysis.winnable);
+  EXPECT_EQ(analysis.winning_dirs, Game::kNone);
+}
+
+TEST(LiveAnalyzer, AgreesWithSolver) {
+  std::mt19937 rbg(1001);
+  LiveAnalyzer analyzer;
+  for (int i = 0; i != 30; ++i) {
+    Game game(4, 5);
+    ASSERT_TRUE(game.AugmentRandomly(1 + i % 4, &rbg, [] { return false; }));
+    SolutionSet solutions;
+    ASSERT_TRUE(game.IsSolvable(&solutions));
+    const std::string code = SaveToHexString(game);
+
+    for (int y = 1; y <= game.Height(); ++y) {
+      for (int x = 1; x <= game.Width(); ++x) {
+        if (!game.Start(x, y)) continue;
+        bool is_solution = false;
+        for (const SolutionSet::Solution& solution : solutions) {
+          is_solution |= solution.Start() == Game::Coord{x, y};
+        }
+        EXPECT_EQ(analyzer.Analyze(game).winnable || game.HaveWon(),
+                  is_solution)
+            << code << " from " << x << ", " << y;
+        game.Reset();
+      }
+    }
+
+    // Follow random moves from a random start, and check each position.
+    for (int k = 0; k != 5; ++k) {
+      const Game::Coord start = solutions[rbg() % solutions.size()].Start();
+      std::vector<Game::Dir> moves;
+      for (;;) {
+        std::unique_ptr<Game> live = Replay(code, start, moves);
+        const Game::Dir dirs = live->ValidDirs();
+        if (dirs == Game::kNone) break;
+        const LiveAnalysis analysis = analyzer.Analyze(*live);
+        EXPECT_EQ(analysis.winnable, BruteForceWinnable(code, start, &moves))
+            << code;
+        Game::Dir choice = Game::kNone;
+        for (Game::Dir dir :
+             {Game::kUp, Game::kDown, Game::kLeft, Game::kRight}) {
+          if ((dirs & dir) == 0) continue;
+          moves.push_back(dir);
+          EXPECT_EQ((analysis.winning_dirs & dir) != 0,
+                    BruteForceWinnable(code, start, &moves))
+              << code;
+          moves.pop_back();
+          if (choice == Game::kNone || rbg() % 2 == 0) choice = dir;
+        }
+        moves.push_back(choice);
+      }
+    }
+  }
+}
+
+TEST(LiveAnalyzer, ReusesSearch) {
+  // A layout with choices along the way that are not immediately decided.
+  std::unique_ptr<Game> layout = LoadFromHexString("770640006000000");
+  Game& game = *layout;
+  SolutionSet solutions;
+  ASSERT_TRUE(game.IsSolvable(&solutions));
+  const SolutionSet::Solution solution = solutions[0];
+
+  LiveAnalyzer analyzer;
+  ASSERT_TRUE(game.Start(solution.Start().x, solution.Start().y));
+  for (Game::Dir dir : solution) {
+    const LiveAnalysis analysis = analyzer.Analyze(game);
+    EXPECT_TRUE(analysis.winnable);
+    EXPECT_NE(analysis.winning_dirs & dir, 0);
+    ASSERT_TRUE(game.MoveFast(dir));
+  }
+  EXPECT_TRUE(game.HaveWon());
+
+  // Playing the same game again needs no new search.
+  const std::size_t memo_size = analyzer.MemoSize();
+  EXPECT_GT(memo_size, 0);
+  game.Reset();
+  ASSERT_TRUE(game.Start(solution.Start().x, solution.Start().y));
+  for (Game::Dir dir : solution) {
+    EXPECT_TRUE(analyzer.Analyze(game).winnable);
+    ASSERT_TRUE(game.MoveFast(dir));
+  }
+  EXPECT_EQ(analyzer.MemoSize(), memo_size);
+
+  // A different layout starts afresh.
+  Game open_game(2, 3);
+  ASSERT_TRUE(open_game.Start(1, 1));
+  EXPECT_TRUE(analyzer.Analyze(open_game).winnable);
+  EXPECT_LT(analyzer.MemoSize(), memo_size);
+}
+
+TEST(LiveAnalyzer, GivesUp) {
+  std::unique_ptr<Game> game = LoadFromHexString(
+      "ff008000042000010000000020010000040080000800000000000008000");
+  ASSERT_TRUE(game->Start(4, 7));
+  const LiveAnalysis expected = LiveAnalyzer().Analyze(*game);
+  EXPECT_TRUE(expected.known);
+
+  LiveAnalyzer analyzer;
+  EXPECT_FALSE(analyzer.Analyze(*game, 10).known);
+  EXPECT_LE(analyzer.MemoSize(), 10);
+  EXPECT_FALSE(analyzer.Analyze(*game, -1, [] { return true; }).known);
+
+  // What was remembered from the searches that were cut short is correct.
+  const LiveAnalysis analysis = analyzer.Analyze(*game);
+  EXPECT_TRUE(analysis.known);
+  EXPECT_EQ(analysis.winnable, expected.winnable);
+  EXPECT_EQ(analysis.winning_dirs, expected.winning_dirs);
+}
+
+}  // namespace
+}  // namespace tkware::lightgame
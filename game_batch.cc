@@ -0,0 +1,305 @@
+// Copyright 2019 by Thomas Köppe
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "game_batch.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "game.h"
+#include "game_bitboard.h"
+
+namespace tkware::lightgame {
+namespace {
+
+#if defined(__AVX2__)
+constexpr int kLanes = 4;
+#elif defined(__SSE2__)
+constexpr int kLanes = 2;
+#else
+constexpr int kLanes = 1;
+#endif
+
+using Word = std::uint64_t;
+
+// One board per lane, laid out as by Bitboard.
+typedef Word Lanes __attribute__((vector_size(kLanes * sizeof(Word))));
+
+// The directions, in the order in which Game::IsSolvable tries them.
+enum Direction { kUp, kDown, kLeft, kRight, kNumDirections };
+
+constexpr Direction kOpposite[kNumDirections] = {kDown, kUp, kRight, kLeft};
+
+bool Any(const Lanes& v) {
+  Word any = 0;
+  for (int l = 0; l != kLanes; ++l) any |= v[l];
+  return any != 0;
+}
+
+// Returns all-ones in the lanes in which v is non-zero, and zero otherwise.
+Lanes NonZero(const Lanes& v) { return reinterpret_cast<Lanes>(v != 0); }
+
+// A depth-first search over fast actions, like Game::IsSolvable, run for
+// several layouts at once. Each lane works on its own layout and has its own
+// stack, and takes the next layout from the batch as soon as its current one
+// is decided. In each round, the choice of the next action (or backtracking)
+// is made per lane, and the fast moves and the pruning of stranded positions
+// are computed for all lanes together.
+class BatchSolver {
+ public:
+  BatchSolver(int height, int width, const std::uint64_t* masks,
+              std::size_t count, bool* solvable)
+      : width_(width),
+        height_(height),
+        stride_(width + 1),
+        vertical_steps_(FillSteps(height)),
+        horizontal_steps_(FillSteps(width)),
+        bitboard_(height, width),
+        masks_(masks),
+        count_(count),
+        solvable_(solvable),
+        stack_(kLanes * (height * width + 1)) {}
+
+  void Run() {
+    for (int l = 0; l != kLanes; ++l) Load(l);
+
+    while (num_active_ != 0) {
+      const Lanes open = free_ & ~on_;
+      Lanes can_move[kNumDirections];
+      for (int d = 0; d != kNumDirections; ++d) {
+        can_move[d] = NonZero(Shift(pos_, Direction(d), 1) & open);
+      }
+
+      Lanes selected[kNumDirections] = {};
+      for (int l = 0; l != kLanes; ++l) {
+        if (!lanes_[l].active) continue;
+        if (open[l] == 0) {
+          Finish(l, true);
+          continue;
+        }
+        unsigned int dirs = 0;
+        for (int d = 0; d != kNumDirections; ++d) {
+          if (can_move[d][l] != 0) dirs |= 1U << d;
+        }
+        dirs &= ~lanes_[l].tried;
+        if (dirs == 0) {
+          Backtrack(l);
+          continue;
+        }
+        const int d = __builtin_ctz(dirs);
+        lanes_[l].tried |= 1U << d;
+        Push(l);
+        selected[d][l] = ~Word{0};
+      }
+
+      MoveFast(selected);
+    }
+  }
+
+ private:
+  struct Lane {
+    bool active = false;
+    std::size_t index = 0;  // of the current layout in the batch
+    Word starts = 0;        // the start fields that are yet to be tried
+    int depth = 0;
+    unsigned int tried = 0;  // the directions tried at the current position
+  };
+
+  struct Frame {
+    Word on, pos;
+    unsigned int tried;
+  };
+
+  // The number of doubling steps that are needed to move across n fields.
+  static int FillSteps(int n) {
+    int steps = 0;
+    while ((1 << steps) < n) ++steps;
+    return steps;
+  }
+
+  // Moves every bit of v by n fields in direction d.
+  Lanes Shift(const Lanes& v, Direction d, int n) const {
+    switch (d) {
+      case kUp:
+        return v >> (n * stride_);
+      case kDown:
+        return v << (n * stride_);
+      case kLeft:
+        return v >> n;
+      default:
+        return v << n;
+    }
+  }
+
+  // Returns the fields from `from` onwards in direction d up to the last open
+  // one, including from itself (a Kogge-Stone fill).
+  Lanes Ray(Lanes from, Lanes open, Direction d) const {
+    const int steps =
+        d == kUp || d == kDown ? vertical_steps_ : horizontal_steps_;
+    for (int k = 0, n = 1; k != steps; ++k, n *= 2) {
+      from |= open & Shift(from, d, n);
+      open &= Shift(open, d, n);
+    }
+    return from;
+  }
+
+  // Makes the fast moves in the selected directions (in the lanes in which
+  // one is selected), and then discards the positions that are stranded.
+  void MoveFast(Lanes* selected) {
+    const Lanes expanded = selected[kUp] | selected[kDown] | selected[kLeft] |
+                           selected[kRight];
+    for (Lanes moving = expanded; Any(moving);) {
+      Lanes open = free_ & ~on_;
+      Lanes ray = {}, end = {};
+      for (int d = 0; d != kNumDirections; ++d) {
+        const Lanes r = Ray(pos_ & selected[d], open, Direction(d));
+        ray |= r;
+        end |= r & ~Shift(r, kOpposite[d], 1);
+      }
+      on_ |= ray;
+      pos_ = (end & moving) | (pos_ & ~moving);
+
+      // Keep going where there is exactly one way on.
+      open = free_ & ~on_;
+      Lanes num_ways = {};
+      for (int d = 0; d != kNumDirections; ++d) {
+        selected[d] = NonZero(Shift(pos_, Direction(d), 1) & open);
+        num_ways -= selected[d];
+      }
+      moving &= NonZero(num_ways == 1);
+      for (int d = 0; d != kNumDirections; ++d) selected[d] &= moving;
+    }
+
+    // As in Game::IsSolvable, a position is stranded if more than one of the
+    // open fields has fewer than two free neighbours (counting the active
+    // field as free), since all but the last field of a path need two.
+    const Lanes dead_ends = bitboard_.DeadEnds(free_ & ~on_, pos_);
+    Lanes stranded = NonZero(dead_ends & (dead_ends - 1)) & expanded;
+
+    for (int l = 0; l != kLanes; ++l) {
+      if (stranded[l] != 0) Pop(l);
+    }
+  }
+
+  Frame& Top(int l) {
+    return stack_[l * (width_ * height_ + 1) + lanes_[l].depth];
+  }
+
+  void Push(int l) {
+    Top(l) = {on_[l], pos_[l], lanes_[l].tried};
+    ++lanes_[l].depth;
+    lanes_[l].tried = 0;
+  }
+
+  void Pop(int l) {
+    --lanes_[l].depth;
+    const Frame& frame = Top(l);
+    on_[l] = frame.on;
+    pos_[l] = frame.pos;
+    lanes_[l].tried = frame.tried;
+  }
+
+  void Backtrack(int l) {
+    if (lanes_[l].depth != 0) {
+      Pop(l);
+    } else if (lanes_[l].starts != 0) {
+      NextStart(l);
+    } else {
+      Finish(l, false);
+    }
+  }
+
+  void NextStart(int l) {
+    const Word start = lanes_[l].starts & -lanes_[l].starts;
+    lanes_[l].starts &= lanes_[l].starts - 1;
+    on_[l] = pos_[l] = start;
+    lanes_[l].tried = 0;
+  }
+
+  void Finish(int l, bool solvable) {
+    solvable_[lanes_[l].index] = solvable;
+    --num_active_;
+    Load(l);
+  }
+
+  // Loads the next layout into lane l, if there is one.
+  void Load(int l) {
+    Lane& lane = lanes_[l];
+    lane = Lane();
+    free_[l] = on_[l] = pos_[l] = 0;
+    for (; next_ != count_; ++next_) {
+      Word free = bitboard_.Board();
+      for (int y = 0; y != height_; ++y) {
+        const Word row = (masks_[next_] >> (width_ * y)) &
+                         ((Word{1} << width_) - 1);
+        free &= ~(row << (stride_ * y));
+      }
+      const Word starts = bitboard_.Starts(free);
+      if (starts == 0) {
+        solvable_[next_] = false;
+        continue;
+      }
+      lane.active = true;
+      lane.index = next_++;
+      lane.starts = starts;
+      free_[l] = free;
+      ++num_active_;
+      NextStart(l);
+      return;
+    }
+  }
+
+  const int width_;
+  const int height_;
+  const int stride_;
+  const int vertical_steps_;
+  const int horizontal_steps_;
+  const Bitboard bitboard_;
+  const std::uint64_t* const masks_;
+  const std::size_t count_;
+  bool* const solvable_;
+
+  std::size_t next_ = 0;
+  int num_active_ = 0;
+
+  Lanes free_ = {};
+  Lanes on_ = {};
+  Lanes pos_ = {};
+  Lane lanes_[kLanes];
+  std::vector<Frame> stack_;
+};
+
+}  // namespace
+
+int BatchLanes() { return kLanes; }
+
+std::uint64_t LayoutMask(const Game& game) {
+  std::uint64_t mask = 0;
+  for (int y = 1; y <= game.Height(); ++y) {
+    for (int x = 1; x <= game.Width(); ++x) {
+      if (game.At(x, y) == Game::State::kBlocked) {
+        mask |= std::uint64_t{1} << (x - 1 + game.Width() * (y - 1));
+      }
+    }
+  }
+  return mask;
+}
+
+void SolveBatch(int height, int width, const std::uint64_t* masks,
+                std::size_t count, bool* solvable) {
+  BatchSolver(height, width, masks, count, solvable).Run();
+}
+
+}  //  namespace tkware::lightgame
@@ -0,0 +1,54 @@
+// Copyright 2019 by Thomas Köppe
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef H_TKWARE_LIGHTGAME_GAME_BATCH_
+#define H_TKWARE_LIGHTGAME_GAME_BATCH_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "game.h"
+#include "game_bitboard.h"
+
+namespace tkware::lightgame {
+
+// Solving many small layouts of the same size at once.
+//
+// Layouts are given as bitmasks of their blocked fields, with bit
+// x - 1 + width * (y - 1) for field x, y. Each board is held in a 64-bit word
+// (with a guard column), and several boards are processed in lock-step in
+// the lanes of one vector register: four with AVX2, two with SSE2, and one
+// otherwise.
+
+// Returns whether boards of the given size can be solved in batches, which
+// is the case if height * (width + 1) <= 64.
+constexpr bool CanSolveInBatch(int height, int width) {
+  return Bitboard::Fits(height, width);
+}
+
+// The number of boards that are processed in lock-step.
+int BatchLanes();
+
+// Returns the mask of the blocked fields of the game.
+std::uint64_t LayoutMask(const Game& game);
+
+// Sets solvable[i] to whether the layout with mask masks[i] is solvable (in the
+// sense of Game::IsSolvable), for each i in [0, count). Requires that
+// CanSolveInBatch(height, width).
+void SolveBatch(int height, int width, const std::uint64_t* masks,
+                std::size_t count, bool* solvable);
+
+}  //  namespace tkware::lightgame
+
+#endif  // H_TKWARE_LIGHTGAME_GAME_BATCH_
@@ -0,0 +1,86 @@
+#include "game_batch.h"
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "game.h"
+#include "gtest/gtest.h"
+
+namespace tkware::lightgame {
+namespace {
+
+std::unique_ptr<Game> FromMask(int height, int width, std::uint64_t mask) {
+  auto game = std::make_unique<Game>(height, width);
+  for (int i = 0; i != height * width; ++i) {
+    if ((mask >> i) & 1) game->SetBlocked(i % width + 1, i / width + 1);
+  }
+  return game;
+}
+
+// Checks SolveBatch against Game::IsSolvable.
+void ExpectSameAsGame(int height, int width,
+                      const std::vector<std::uint64_t>& masks) {
+  std::unique_ptr<bool[]> solvable(new bool[masks.size()]);
+  SolveBatch(height, width, masks.data(), masks.size(), solvable.get());
+  for (std::size_t i = 0; i != masks.size(); ++i) {
+    std::unique_ptr<Game> game = FromMask(height, width, masks[i]);
+    ASSERT_EQ(solvable[i], game->IsSolvable(nullptr))
+        << height << " x " << width << ": " << SaveToHexString(*game);
+  }
+}
+
+TEST(SolveBatch, AllSmallLayouts) {
+  for (auto [h, w] : {std::pair{1, 1}, {1, 5}, {4, 1}, {2, 3}, {3, 3},
+                      {3, 4}, {4, 4}}) {
+    std::vector<std::uint64_t> masks;
+    for (std::uint64_t mask = 0; mask != std::uint64_t{1} << (h * w); ++mask) {
+      masks.push_back(mask);
+    }
+    ExpectSameAsGame(h, w, masks);
+  }
+}
+
+TEST(SolveBatch, RandomLayouts) {
+  std::mt19937 rbg(1001);
+  for (auto [h, w] : {std::pair{5, 5}, {5, 6}, {6, 6}, {7, 7}, {8, 7},
+                      {1, 31}, {32, 1}, {3, 15}}) {
+    std::vector<std::uint64_t> masks;
+    for (int i = 0; i != 300; ++i) {
+      std::uint64_t mask = 0;
+      // Few blocked fields, so that many layouts are solvable.
+      for (int k = 0; k != (h * w) / 8; ++k) {
+        mask |= std::uint64_t{1} << (rbg() % (h * w));
+      }
+      masks.push_back(mask);
+    }
+    ExpectSameAsGame(h, w, masks);
+  }
+}
+
+TEST(SolveBatch, EmptyBatch) {
+  SolveBatch(3, 3, nullptr, 0, nullptr);
+}
+
+TEST(LayoutMask, MatchesFields) {
+  Game game(2, 3);
+  EXPECT_EQ(LayoutMask(game), 0);
+  game.SetBlocked(2, 1);
+  game.SetBlocked(1, 2);
+  EXPECT_EQ(LayoutMask(game), 0b001010);
+  EXPECT_EQ(SaveToHexString(*FromMask(2, 3, 0b001010)),
+            SaveToHexString(game));
+}
+
+TEST(CanSolveInBatch, Limits) {
+  EXPECT_TRUE(CanSolveInBatch(1, 1));
+  EXPECT_TRUE(CanSolveInBatch(7, 7));
+  EXPECT_TRUE(CanSolveInBatch(8, 7));
+  EXPECT_FALSE(CanSolveInBatch(8, 8));
+  EXPECT_FALSE(CanSolveInBatch(0, 3));
+  EXPECT_GE(BatchLanes(), 1);
+}
+
+}  // namespace
+}  // namespace tkware::lightgame
@@ -1,6 +1,19 @@
 #include "game.h"
+#include "game_batch.h"
+#include "game_bitboard.h"
+#include "game_generate.h"
+#include "game_parallel.h"
+#include "game_repair.h"
+#include "game_segments.h"
+#include "game_verify.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
 
 #include "benchmark/benchmark.h"
 
@@ -19,6 +32,238 @@ void BM_SolveLargeGame(benchmark::State& state) {
 
 BENCHMARK(BM_SolveLargeGame);
 
+// The layouts from the GOOD_GAMES file.
+constexpr const char* kGoodGames[] = {
+    "6902400412202000",   "6914888000000000",
+    "69000804010a0000",   "6900180000100000",
+    "6980440062005002",   "75040208103",
+    "778011A01203040",    "770480102606500",
+    "77180413A400100",    "77180C100202500",
+    "77C011220403100",    "778058805008201",
+    "778011022443040",    "780821248002200C",
+    "790000020108120010", "79489204108c000000",
+    "8700204008058000",   "99408004000020100000000",
+    "9A00000000000800a03004000",
+};
+
+void BM_SolveGoodGames(benchmark::State& state) {
+  std::vector<std::unique_ptr<Game>> games;
+  for (const char* code : kGoodGames) {
+    games.push_back(LoadFromHexString(code));
+  }
+
+  std::vector<int> solutions;
+  for (auto _ : state) {
+    for (const auto& game : games) {
+      solutions.clear();
+      bool b = game->IsSolvable(&solutions);
+      benchmark::DoNotOptimize(b);
+      assert(b);
+    }
+  }
+}
+
+BENCHMARK(BM_SolveGoodGames);
+
+void BM_FirstSolutionOfGoodGames(benchmark::State& state) {
+  std::vector<std::unique_ptr<Game>> games;
+  for (const char* code : kGoodGames) {
+    games.push_back(LoadFromHexString(code));
+  }
+
+  SolutionSet solutions;
+  for (auto _ : state) {
+    for (const auto& game : games) {
+      solutions.clear();
+      bool b = SolutionCursor(*game).Next(&solutions);
+      benchmark::DoNotOptimize(b);
+      assert(b);
+    }
+  }
+}
+
+BENCHMARK(BM_FirstSolutionOfGoodGames);
+
+void BM_SolveGoodGamesInParallel(benchmark::State& state) {
+  std::vector<std::unique_ptr<Game>> games;
+  for (const char* code : kGoodGames) {
+    games.push_back(LoadFromHexString(code));
+  }
+
+  std::vector<int> solutions;
+  for (auto _ : state) {
+    for (const auto& game : games) {
+      solutions.clear();
+      bool b = IsSolvableInParallel(*game, state.range(0), &solutions);
+      benchmark::DoNotOptimize(b);
+      assert(b);
+    }
+  }
+}
+
+BENCHMARK(BM_SolveGoodGamesInParallel)->Arg(1)->Arg(2)->Arg(4)->UseRealTime();
+
+void BM_VerifySolutions(benchmark::State& state) {
+  Game game(7, 9);
+  game.SetBlocked(3, 3);
+  std::vector<int> solutions;
+  game.IsSolvable(&solutions);
+  const std::size_t n = std::count(solutions.begin(), solutions.end(), 0);
+  std::vector<VerifyResult> results(n);
+
+  SolutionVerifier verifier(game);
+  for (auto _ : state) {
+    verifier.VerifyAll(solutions.data(), solutions.data() + solutions.size(),
+                       results.data(), results.size());
+    benchmark::DoNotOptimize(results.data());
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+BENCHMARK(BM_VerifySolutions);
+
+// Random layouts of size n x n with n blocked fields, as bitmasks.
+std::vector<std::uint64_t> RandomMasks(int n, int count) {
+  std::mt19937 rbg(1001);
+  std::vector<std::uint64_t> masks;
+  for (int i = 0; i != count; ++i) {
+    std::uint64_t mask = 0;
+    for (int k = 0; k != n; ++k) mask |= std::uint64_t{1} << (rbg() % (n * n));
+    masks.push_back(mask);
+  }
+  return masks;
+}
+
+void BM_SolveLoop(benchmark::State& state) {
+  const int n = state.range(0);
+  std::vector<std::unique_ptr<Game>> games;
+  for (std::uint64_t mask : RandomMasks(n, 1024)) {
+    games.push_back(std::make_unique<Game>(n, n));
+    for (int i = 0; i != n * n; ++i) {
+      if ((mask >> i) & 1) games.back()->SetBlocked(i % n + 1, i / n + 1);
+    }
+  }
+  for (auto _ : state) {
+    for (const auto& game : games) {
+      bool b = game->IsSolvable(nullptr);
+      benchmark::DoNotOptimize(b);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * games.size());
+}
+
+BENCHMARK(BM_SolveLoop)->DenseRange(4, 6);
+
+// As above, but always searching, even where IsSolvable uses a table lookup.
+void BM_SearchLoop(benchmark::State& state) {
+  const int n = state.range(0);
+  std::vector<std::unique_ptr<Game>> games;
+  for (std::uint64_t mask : RandomMasks(n, 1024)) {
+    games.push_back(std::make_unique<Game>(n, n));
+    for (int i = 0; i != n * n; ++i) {
+      if ((mask >> i) & 1) games.back()->SetBlocked(i % n + 1, i / n + 1);
+    }
+  }
+  for (auto _ : state) {
+    for (const auto& game : games) {
+      bool b = SolutionCursor(*game).Next(nullptr);
+      benchmark::DoNotOptimize(b);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * games.size());
+}
+
+BENCHMARK(BM_SearchLoop)->Arg(4);
+
+void BM_SolveBySegments(benchmark::State& state) {
+  const int n = state.range(0);
+  std::vector<std::unique_ptr<Game>> games;
+  for (std::uint64_t mask : RandomMasks(n, 1024)) {
+    games.push_back(std::make_unique<Game>(n, n));
+    for (int i = 0; i != n * n; ++i) {
+      if ((mask >> i) & 1) games.back()->SetBlocked(i % n + 1, i / n + 1);
+    }
+  }
+  for (auto _ : state) {
+    for (const auto& game : games) {
+      bool b = SolveBySegments(*game, nullptr);
+      benchmark::DoNotOptimize(b);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * games.size());
+}
+
+BENCHMARK(BM_SolveBySegments)->DenseRange(4, 6);
+
+// All solutions of the good games that fit into a bit set, by each engine.
+bool SolveForward(const Game& game, std::vector<int>* solutions) {
+  return game.IsSolvable(solutions);
+}
+
+template <bool (*Solve)(const Game&, std::vector<int>*)>
+void BM_SolveSmallGoodGames(benchmark::State& state) {
+  std::vector<std::unique_ptr<Game>> games;
+  for (const char* code : kGoodGames) {
+    std::unique_ptr<Game> game = LoadFromHexString(code);
+    if (Bitboard::Fits(game->Height(), game->Width())) {
+      games.push_back(std::move(game));
+    }
+  }
+
+  std::vector<int> solutions;
+  for (auto _ : state) {
+    for (const auto& game : games) {
+      solutions.clear();
+      bool b = Solve(*game, &solutions);
+      benchmark::DoNotOptimize(b);
+      assert(b);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * games.size());
+}
+
+BENCHMARK_TEMPLATE(BM_SolveSmallGoodGames, SolveForward);
+BENCHMARK_TEMPLATE(BM_SolveSmallGoodGames, SolveBySegments);
+
+void BM_SolveBatch(benchmark::State& state) {
+  const int n = state.range(0);
+  const std::vector<std::uint64_t> masks = RandomMasks(n, 1024);
+  std::unique_ptr<bool[]> solvable(new bool[masks.size()]);
+  for (auto _ : state) {
+    SolveBatch(n, n, masks.data(), masks.size(), solvable.get());
+    benchmark::DoNotOptimize(solvable.get());
+  }
+  state.SetItemsProcessed(state.iterations() * masks.size());
+}
+
+BENCHMARK(BM_SolveBatch)->DenseRange(4, 6);
+
+// The first 20 unsolvable layouts of the random layouts above, with up to
+// two edits.
+void BM_RepairLayout(benchmark::State& state) {
+  const int n = state.range(0);
+  std::vector<std::unique_ptr<Game>> games;
+  for (std::uint64_t mask : RandomMasks(n, 1024)) {
+    auto game = std::make_unique<Game>(n, n);
+    for (int i = 0; i != n * n; ++i) {
+      if ((mask >> i) & 1) game->SetBlocked(i % n + 1, i / n + 1);
+    }
+    if (!game->IsSolvable(nullptr)) games.push_back(std::move(game));
+    if (games.size() == 20) break;
+  }
+
+  std::vector<LayoutEdit> edits;
+  for (auto _ : state) {
+    for (const auto& game : games) {
+      bool b = RepairLayout(*game, 2, 1, &edits);
+      benchmark::DoNotOptimize(b);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * games.size());
+}
+
+BENCHMARK(BM_RepairLayout)->DenseRange(4, 8, 2);
+
 void BM_GenerateLargeGames(benchmark::State& state) {
   for (auto _ : state) {
     state.PauseTiming();
@@ -35,5 +280,53 @@ void BM_GenerateLargeGames(benchmark::State& state) {
 
 BENCHMARK(BM_GenerateLargeGames);
 
+void BM_GenerateFromPath(benchmark::State& state) {
+  const int n = state.range(0);
+  std::mt19937 rbg(1001);
+  for (auto _ : state) {
+    Game game(n, n);
+    bool b = GenerateFromPath(&game, 0, n * n, 1, &rbg);
+    benchmark::DoNotOptimize(b);
+    assert(b);
+  }
+  state.SetComplexityN(n * n);
+}
+
+BENCHMARK(BM_GenerateFromPath)->RangeMultiplier(2)->Range(8, 128)->Complexity();
+
+void BM_GenerateInParallel(benchmark::State& state) {
+  const auto mode = GenerationMode(state.range(0));
+  const int num_threads = state.range(1);
+  std::uint64_t seed = 1001;
+  for (auto _ : state) {
+    Game game(6, 7);
+    bool b = AugmentRandomlyInParallel(&game, 7, seed++, num_threads, mode);
+    benchmark::DoNotOptimize(b);
+    assert(b);
+  }
+}
+
+BENCHMARK(BM_GenerateInParallel)
+    ->ArgsProduct({{int(GenerationMode::kRace),
+                    int(GenerationMode::kDeterministic)},
+                   {1, 2, 4, 8}})
+    ->UseRealTime();
+
+void BM_GenerateWithTarget(benchmark::State& state) {
+  GenerationTarget target;
+  target.max_starts = 3;
+  target.min_length = 4;
+  target.min_branching = state.range(0);
+  std::mt19937 rbg(1001);
+  for (auto _ : state) {
+    Game game(6, 6);
+    bool b = GenerateWithTarget(&game, 6, target, &rbg, 1000000);
+    benchmark::DoNotOptimize(b);
+    assert(b);
+  }
+}
+
+BENCHMARK(BM_GenerateWithTarget)->Arg(0)->Arg(4);
+
 }  // namespace
 }  // namespace tkware::lightgame
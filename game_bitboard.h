@@ -0,0 +1,208 @@
+// Copyright 2019 by Thomas Köppe
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef H_TKWARE_LIGHTGAME_GAME_BITBOARD_
+#define H_TKWARE_LIGHTGAME_GAME_BITBOARD_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "game.h"
+
+namespace tkware::lightgame {
+
+// The geometry of a board of up to 64 fields that is held as a bit set, as
+// used by the bit-parallel engines. Field x, y (zero-based) is bit
+// x + (width + 1) * y; the extra column is never part of the board, so that
+// horizontal shifts cannot wrap around from one row to the next.
+//
+// The operations on sets of fields are templates, so that they apply both to
+// single words and to vectors of words (one board per lane).
+class Bitboard {
+ public:
+  using Word = std::uint64_t;
+
+  // The directions, in the order in which Game::IsSolvable tries them.
+  enum Direction { kUp, kDown, kLeft, kRight, kNumDirections };
+
+  static constexpr Direction kOpposite[kNumDirections] = {kDown, kUp, kRight,
+                                                          kLeft};
+  static constexpr Game::Dir kGameDirs[kNumDirections] = {
+      Game::kUp, Game::kDown, Game::kLeft, Game::kRight};
+
+  // A position of a game on a bit board: the fields that are "on", and the
+  // active field.
+  struct State {
+    Word on;
+    int pos;
+
+    friend bool operator==(const State& lhs, const State& rhs) {
+      return lhs.on == rhs.on && lhs.pos == rhs.pos;
+    }
+  };
+
+  struct StateHash {
+    Word operator()(const State& state) const {
+      return (state.on ^ (Word(state.pos) << 58)) * 0x9E3779B97F4A7C15;
+    }
+  };
+
+  // Returns whether boards of the given size fit into a word.
+  static constexpr bool Fits(int height, int width) {
+    return height >= 1 && width >= 1 && height * (width + 1) <= 64;
+  }
+
+  // Requires Fits(height, width).
+  Bitboard(int height, int width) : stride_(width + 1) {
+    for (int y = 0; y != height; ++y) {
+      board_ |= ((Word{1} << width) - 1) << (stride_ * y);
+      for (int x = y % 2; x < width; x += 2) black_ |= Bit(x, y);
+    }
+  }
+
+  int Stride() const { return stride_; }
+
+  // All fields, and the fields x, y with even x + y.
+  Word Board() const { return board_; }
+  Word Black() const { return black_; }
+
+  Word Bit(int x, int y) const { return Word{1} << (x + stride_ * y); }
+
+  // Returns the fields of the game that are not blocked.
+  Word FreeFields(const Game& game) const {
+    Word free = 0;
+    for (int y = 1; y <= game.Height(); ++y) {
+      for (int x = 1; x <= game.Width(); ++x) {
+        if (game.At(x, y) != Game::State::kBlocked) free |= Bit(x - 1, y - 1);
+      }
+    }
+    return free;
+  }
+
+  // Returns the fields of v moved by one field in the given direction.
+  template <typename V> V Up(const V& v) const { return v >> stride_; }
+  template <typename V> V Down(const V& v) const { return v << stride_; }
+  template <typename V> V Left(const V& v) const { return v >> 1; }
+  template <typename V> V Right(const V& v) const { return v << 1; }
+
+  template <typename V>
+  V Step(const V& v, Direction d) const {
+    switch (d) {
+      case kUp:
+        return Up(v);
+      case kDown:
+        return Down(v);
+      case kLeft:
+        return Left(v);
+      default:
+        return Right(v);
+    }
+  }
+
+  // Returns the fields of open with fewer than two neighbours in open or
+  // extra. All fields but the ends of a path through open need two.
+  template <typename V>
+  V DeadEnds(const V& open, const V& extra) const {
+    const V x = open | extra;
+    const V up = Down(x) & open, down = Up(x) & open;
+    const V left = Right(x) & open, right = Left(x) & open;
+    const V two = (up & (down | left | right)) | (down & (left | right)) |
+                  (left & right);
+    return open & ~two;
+  }
+
+  // Returns the fields of within that are connected to from through within.
+  Word Reach(Word from, Word within) const {
+    Word reached = from & within;
+    for (Word last = 0; reached != last;) {
+      last = reached;
+      reached |= within & (Up(reached) | Down(reached) | Left(reached) |
+                           Right(reached));
+    }
+    return reached;
+  }
+
+  // As Game::IsStranded, for the open fields and the active field pos: the
+  // game is lost if more than one open field is a dead end, or if not all
+  // open fields can be reached from pos.
+  bool IsStranded(Word open, int pos) const {
+    const Word here = Word{1} << pos;
+    const Word dead_ends = DeadEnds(open, here);
+    if ((dead_ends & (dead_ends - 1)) != 0) return true;
+    const Word next = (Up(here) | Down(here) | Left(here) | Right(here)) & open;
+    return Reach(next, open) != open;
+  }
+
+  // Returns the fields from which a winning path over the free fields may
+  // start, or zero if there is none. Such a path exists only if the free
+  // fields are connected, and it has to start or end at each dead end. It
+  // also alternates between the colours of a chessboard, so it can only exist
+  // if there are as many fields of one colour as of the other, or one more,
+  // in which case it starts on that colour.
+  Word Starts(Word free) const {
+    if (free == 0 || Reach(free & -free, free) != free) return 0;
+
+    const Word dead_ends = DeadEnds(free, Word{0});
+    Word starts = free;
+    switch (__builtin_popcountll(dead_ends)) {
+      case 0:
+      case 1:
+        break;
+      case 2:
+        starts = dead_ends;
+        break;
+      default:
+        return 0;
+    }
+
+    const int num_black = __builtin_popcountll(free & black_);
+    const int num_white = __builtin_popcountll(free & ~black_);
+    if (num_black == num_white + 1) return starts & black_;
+    if (num_white == num_black + 1) return starts & ~black_;
+    return num_black == num_white ? starts : 0;
+  }
+
+ private:
+  const int stride_;
+  Word board_ = 0;
+  Word black_ = 0;
+};
+
+// A direct-mapped table of 2^bits states, in which a state replaces whichever
+// state was in its slot. The solvers remember losing states in it.
+class StateMemo {
+ public:
+  using State = Bitboard::State;
+
+  explicit StateMemo(int bits)
+      : shift_(64 - bits), slots_(std::size_t{1} << bits, State{0, -1}) {}
+
+  bool Contains(const State& state) const {
+    return slots_[Slot(state)] == state;
+  }
+  void Insert(const State& state) { slots_[Slot(state)] = state; }
+
+ private:
+  std::size_t Slot(const State& state) const {
+    return Bitboard::StateHash()(state) >> shift_;
+  }
+
+  const int shift_;
+  std::vector<State> slots_;
+};
+
+}  //  namespace tkware::lightgame
+
+#endif  // H_TKWARE_LIGHTGAME_GAME_BITBOARD_
@@ -16,27 +16,65 @@
 //
 // A command-line interface for the game.
 //
+// Usage: game_cli [--pool=PATH] [--record=PATH]
+//        game_cli --replay=PATH [--render]
+//
+// Random layouts are served from a pool of pre-generated layouts that is
+// refilled in the background; with --pool, the pool is kept in the file at
+// PATH across runs. With --record, the session is recorded to the file at
+// PATH (see game_session.h).
+//
+// With --replay, the recorded session in the file at PATH is replayed at full
+// speed instead, checking that every move and the outcome of every game are
+// as recorded, and the throughput is reported. With --render, the board is
+// printed after every event.
+//
 // Commands:
 //
 //   n <h> <w>:  new, blank layout of dimensions h times w
 //   g <h> <w>:  randomly generated, solvable layout
+//   p <h> <w>:  randomly generated layout that is built around a random winning
+//               path, which is instant even for large boards
+//   d <h> <w> <n> <seed>:
+//               randomly generated, solvable layout with n blocked tiles; the
+//               same seed always results in the same layout
+//   u <h> <w> <n>:
+//               randomly generated layout with n blocked tiles that can only
+//               be won from one start
 //   b <x> <y>:  marks tile x, y as blocked
+//   f <e> <n>:  suggests at most e tiles to block or unblock so that the
+//               layout can be won from at least n starts; gives up after ten
+//               seconds
 //   s <x> <y>:  starts a game at tile x, y (if possible)
 //   r        :  resets a game in progress, returns to layout mode
 //   a <N>    :  takes an action: N = 1 (up), 2 (down), 3 (left), 4 (right)
 
+#include <algorithm>
 #include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
 #include <iostream>
 #include <memory>
 #include <random>
 #include <sstream>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "game.h"
+#include "game_generate.h"
+#include "game_pool.h"
+#include "game_repair.h"
+#include "game_session.h"
+#include "game_trace.h"
 
 namespace tkware::lightgame {
 namespace {
 
+// The search for repairs grows exponentially with the number of edits.
+constexpr std::chrono::seconds kRepairTimeLimit(10);
+
 bool ParseCommand2Arg(const std::string& line, int* h, int* w, char X) {
   std::istringstream iss(line);
   char c;
@@ -61,6 +99,10 @@ bool ParseSetBlocked(const std::string& line, int* h, int* w) {
   return ParseCommand2Arg(line, h, w, 'b');
 }
 
+bool ParseRepair(const std::string& line, int* e, int* n) {
+  return ParseCommand2Arg(line, e, n, 'f');
+}
+
 bool ParseStart(const std::string& line, int* h, int* w) {
   return ParseCommand2Arg(line, h, w, 's');
 }
@@ -73,6 +115,27 @@ bool ParseCreateRandom(const std::string& line, int* h, int* w) {
   return ParseCommand2Arg(line, h, w, 'g');
 }
 
+bool ParseFromPath(const std::string& line, int* h, int* w) {
+  return ParseCommand2Arg(line, h, w, 'p');
+}
+
+bool ParseSeeded(const std::string& line, int* h, int* w, int* n,
+                 std::uint64_t* seed) {
+  std::istringstream iss(line);
+  char c;
+  bool b(iss >> c >> *h >> *w >> *n >> *seed);
+  iss >> std::ws;
+  return b && iss.eof() && (c == 'd' || c == 'D');
+}
+
+bool ParseUniqueStart(const std::string& line, int* h, int* w, int* n) {
+  std::istringstream iss(line);
+  char c;
+  bool b(iss >> c >> *h >> *w >> *n);
+  iss >> std::ws;
+  return b && iss.eof() && (c == 'u' || c == 'U');
+}
+
 bool ParseAction(const std::string& line, int* d) {
   std::istringstream iss(line);
   char c;
@@ -93,43 +156,22 @@ std::string PrintDirs(const Game::Dir dir) {
 }
 
 void PrintBoard(std::ostream& os, const Game& game) {
-  auto to_char = [](Game::State s) {
-    switch (s) {
-      case Game::State::kOff:
-        return 'O';
-      case Game::State::kOn:
-        return 'X';
-      case Game::State::kBlocked:
-        return '#';
-      default:
-        return ' ';
-    }
-  };
-
-  auto render_at = [&game, &to_char](int x, int y) {
-    return x == game.X() && y == game.Y() ? '*' : to_char(game.At(x, y));
-  };
-
-  for (int y = 1; y <= game.Height(); ++y) {
-    os << '+';
-    for (int x = 1; x <= game.Width(); ++x) {
-      os << "-+";
-    }
-    os << "\n|";
-    for (int x = 1; x <= game.Width(); ++x) {
-      os << render_at(x, y) << '|';
-    }
-    os << "\n";
-  }
-  os << '+';
-  for (int x = 1; x <= game.Width(); ++x) {
-    os << "-+";
-  }
-  os << "\n";
+  std::string board;
+  RenderBoard(game, &board);
+  os << board;
 }
 
-void Run() {
+void Run(const std::string& pool_path, SessionWriter* recorder) {
+  PuzzlePool pool(pool_path);
+  std::mt19937 rbg(std::random_device{}());
   std::unique_ptr<Game> game;
+
+  auto make_move = [&game, recorder](Game::Dir dir) {
+    const bool accepted = game->Move(dir);
+    if (recorder != nullptr) recorder->Move(*game, dir, false, accepted);
+    return accepted;
+  };
+
   for (std::string line; std::cout << "> " && std::getline(std::cin, line);) {
     int a, b, d;
     if (ParseNewGame(line, &a, &b)) {
@@ -144,12 +186,35 @@ void Run() {
       } else {
         PrintBoard(std::cout, *game);
       }
+    } else if (ParseRepair(line, &a, &b)) {
+      const auto deadline = std::chrono::steady_clock::now() + kRepairTimeLimit;
+      bool timed_out = false;
+      std::vector<LayoutEdit> edits;
+      if (game == nullptr) {
+        std::cout << "No game in progress!\n";
+      } else if (!RepairLayout(*game, a, b, &edits, [&] {
+                   return timed_out =
+                              std::chrono::steady_clock::now() > deadline;
+                 })) {
+        std::cout << "No repair with at most " << a << " edits found"
+                  << (timed_out ? " in time" : "") << ".\n";
+      } else if (edits.empty()) {
+        std::cout << "The layout needs no repair.\n";
+      } else {
+        std::cout << "Suggested edits:";
+        for (const LayoutEdit& edit : edits) {
+          std::cout << (edit.block ? " block (" : " unblock (") << edit.pos.x
+                    << ", " << edit.pos.y << ")";
+        }
+        std::cout << "\n";
+      }
     } else if (ParseStart(line, &a, &b)) {
       if (game == nullptr) {
         std::cout << "No game in progress!\n";
       } else if (!game->Start(a, b)) {
         std::cout << "Invalid start position (" << a << ", " << b << ")!\n";
       } else {
+        if (recorder != nullptr) recorder->Start(*game);
         PrintBoard(std::cout, *game);
         std::cout << "Valid directions: " << PrintDirs(game->ValidDirs()) << "\n";
       }
@@ -157,32 +222,66 @@ void Run() {
       if (game == nullptr) {
         std::cout << "No game in progress!\n";
       } else {
+        if (recorder != nullptr && game->HasStarted()) recorder->Reset();
         game->Reset();
         PrintBoard(std::cout, *game);
       }
     } else if (ParseCreateRandom(line, &a, &b)) {
-      std::mt19937 rbg(std::random_device{}());
-      std::uniform_int_distribution dh(1, a);
-      std::uniform_int_distribution dw(1, b);
-
-      for (;;) {
-        game = std::make_unique<Game>(a, b);
-        int n = std::uniform_int_distribution(3, 6)(rbg);
-        for (int i = 0; i != n; ++i) {
-          game->SetBlocked(dw(rbg), dh(rbg));
-        }
-        if (game->IsSolvable(nullptr)) {
-          PrintBoard(std::cout, *game);
-          break;
-        }
+      const int max_blocks = std::min(6, a * b - 1);
+      const int min_blocks = std::min(3, max_blocks);
+      if (auto new_game = pool.Take({a, b, min_blocks, max_blocks}, &rbg)) {
+        game = std::move(new_game);
+        PrintBoard(std::cout, *game);
+      } else {
+        std::cout << "Invalid dimensions " << a << " x " << b << "!\n";
+      }
+    } else if (ParseFromPath(line, &a, &b)) {
+      // Aims for between 1/16 and 1/8 of the tiles blocked, which most paths
+      // come close to.
+      const int min_blocks = a * b / 16, max_blocks = a * b / 8;
+      if (a < 1 || b < 1) {
+        std::cout << "Invalid dimensions " << a << " x " << b << "!\n";
+      } else if (auto new_game = std::make_unique<Game>(a, b);
+                 GenerateFromPath(new_game.get(), min_blocks, max_blocks, 1000,
+                                  &rbg)) {
+        game = std::move(new_game);
+        PrintBoard(std::cout, *game);
+        std::cout << "Code: " << SaveToHexString(*game) << "\n";
+      } else {
+        std::cout << "No such layout found with " << min_blocks << " to "
+                  << max_blocks << " blocked tiles!\n";
+      }
+    } else if (std::uint64_t seed; ParseSeeded(line, &a, &b, &d, &seed)) {
+      if (a < 1 || b < 1) {
+        std::cout << "Invalid dimensions " << a << " x " << b << "!\n";
+      } else if (auto new_game = std::make_unique<Game>(a, b);
+                 AugmentRandomlyInParallel(new_game.get(), d, seed, 0,
+                                           GenerationMode::kDeterministic)) {
+        game = std::move(new_game);
+        PrintBoard(std::cout, *game);
+        std::cout << "Code: " << SaveToHexString(*game) << "\n";
+      } else {
+        std::cout << "Invalid number of blocked tiles (" << d << ")!\n";
+      }
+    } else if (int n; ParseUniqueStart(line, &a, &b, &n)) {
+      if (a < 1 || b < 1) {
+        std::cout << "Invalid dimensions " << a << " x " << b << "!\n";
+      } else if (auto new_game = std::make_unique<Game>(a, b);
+                 GenerateWithTarget(new_game.get(), n, GenerationTarget(),
+                                    &rbg, 100000)) {
+        game = std::move(new_game);
+        PrintBoard(std::cout, *game);
+        std::cout << "Code: " << SaveToHexString(*game) << "\n";
+      } else {
+        std::cout << "No such layout found with " << n << " blocked tiles!\n";
       }
     } else if (ParseAction(line, &d)) {
       if (game == nullptr) {
         std::cout << "No game in progress!\n";
-      } else if ((d == 1 && game->Move(Game::kUp))   ||
-                 (d == 2 && game->Move(Game::kDown)) ||
-                 (d == 3 && game->Move(Game::kLeft)) ||
-                 (d == 4 && game->Move(Game::kRight))) {
+      } else if ((d == 1 && make_move(Game::kUp))   ||
+                 (d == 2 && make_move(Game::kDown)) ||
+                 (d == 3 && make_move(Game::kLeft)) ||
+                 (d == 4 && make_move(Game::kRight))) {
         PrintBoard(std::cout, *game);
         if (Game::Dir dirs = game->ValidDirs(); dirs == Game::kNone) {
           if (game->HaveWon()) {
@@ -202,9 +301,72 @@ void Run() {
   std::cout << "Goodbye!\n";
 }
 
+bool Replay(const std::string& path, bool render) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    std::cerr << "Cannot read '" << path << "'\n";
+    return false;
+  }
+  SessionReader reader(&in);
+  const ReplayStats stats =
+      ReplaySession(&reader, render ? &std::cout : nullptr);
+  std::cout << stats.num_events << " events, " << stats.num_games
+            << " games (" << stats.num_wins << " won), " << stats.num_moves
+            << " moves in "
+            << std::chrono::duration<double>(stats.elapsed).count() << " s ("
+            << stats.MovesPerSecond() << " moves/s)\n";
+  if (!stats.first_error.empty()) {
+    std::cout << stats.num_mismatches << " mismatches; first: "
+              << stats.first_error << "\n";
+    return false;
+  }
+  return true;
+}
+
 }  // namespace
 }  // namespace tkware::lightgame
 
-int main() {
-  tkware::lightgame::Run();
+int main(int argc, char* argv[]) {
+  tkware::lightgame::StartTracingFromEnv();
+  std::string pool_path, record_path, replay_path;
+  bool render = false, bad_usage = false;
+  for (int i = 1; i < argc && !bad_usage; ++i) {
+    const std::string arg = argv[i];
+    if (arg.rfind("--pool=", 0) == 0) {
+      pool_path = arg.substr(7);
+    } else if (arg.rfind("--record=", 0) == 0) {
+      record_path = arg.substr(9);
+    } else if (arg.rfind("--replay=", 0) == 0) {
+      replay_path = arg.substr(9);
+    } else if (arg == "--render") {
+      render = true;
+    } else {
+      bad_usage = true;
+    }
+  }
+  if (bad_usage ||
+      (!replay_path.empty() && (!pool_path.empty() || !record_path.empty())) ||
+      (render && replay_path.empty())) {
+    std::cerr << "Usage: " << argv[0] << " [--pool=PATH] [--record=PATH]\n"
+              << "       " << argv[0] << " --replay=PATH [--render]\n";
+    return 1;
+  }
+
+  if (!replay_path.empty()) {
+    return tkware::lightgame::Replay(replay_path, render) ? 0 : 1;
+  }
+
+  std::unique_ptr<std::ofstream> record_file;
+  std::unique_ptr<tkware::lightgame::SessionWriter> recorder;
+  if (!record_path.empty()) {
+    record_file = std::make_unique<std::ofstream>(
+        record_path, std::ios::binary | std::ios::trunc);
+    if (!*record_file) {
+      std::cerr << "Cannot write to '" << record_path << "'\n";
+      return 1;
+    }
+    recorder =
+        std::make_unique<tkware::lightgame::SessionWriter>(record_file.get());
+  }
+  tkware::lightgame::Run(pool_path, recorder.get());
 }
@@ -0,0 +1,325 @@
+// Copyright 2019 by Thomas Köppe
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "game_corpus.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "game.h"
+#include "game_generate.h"
+
+namespace tkware::lightgame {
+namespace {
+
+constexpr char kMagic[8] = {'L', 'G', 'C', 'O', 'R', 'P', 'U', 'S'};
+constexpr std::uint32_t kVersion = 1;
+constexpr std::size_t kHeaderSize = 64;
+
+struct Header {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t record_size;
+  std::uint64_t num_records;
+  std::uint64_t sizes_offset;
+  std::uint64_t index_offset;
+  std::uint32_t num_sizes;
+  std::uint8_t reserved[20];
+};
+
+static_assert(sizeof(Header) == kHeaderSize);
+
+bool Fail(std::string* error, const std::string& message) {
+  if (error != nullptr) *error = message;
+  return false;
+}
+
+std::uint8_t Clamp(int n) {
+  return std::clamp(n, 0, int{std::numeric_limits<std::uint8_t>::max()});
+}
+
+}  // namespace
+
+std::unique_ptr<Game> CorpusRecord::ToGame() const {
+  if (height == 0 || width == 0 || height * width > kCorpusMaxFields) {
+    return nullptr;
+  }
+  auto game = std::make_unique<Game>(height, width);
+  game->LoadLayoutFromBits(layout, 8);
+  return game;
+}
+
+std::unique_ptr<CorpusReader> CorpusReader::Open(const std::string& path,
+                                                 std::string* error) {
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    Fail(error, "cannot open '" + path + "'");
+    return nullptr;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < 0 ||
+      static_cast<std::size_t>(st.st_size) < kHeaderSize) {
+    close(fd);
+    Fail(error, "'" + path + "' is not a corpus");
+    return nullptr;
+  }
+
+  std::unique_ptr<CorpusReader> reader(new CorpusReader);
+  reader->data_size_ = st.st_size;
+  reader->data_ =
+      mmap(nullptr, reader->data_size_, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (reader->data_ == MAP_FAILED) {
+    reader->data_ = nullptr;
+    Fail(error, "cannot map '" + path + "'");
+    return nullptr;
+  }
+
+  const char* const data = static_cast<const char*>(reader->data_);
+  Header header;
+  std::memcpy(&header, data, sizeof header);
+  const std::uint64_t n = header.num_records;
+  if (!std::equal(kMagic, kMagic + sizeof kMagic, header.magic) ||
+      header.version != kVersion || header.record_size != kCorpusRecordSize ||
+      n > std::numeric_limits<std::uint32_t>::max() ||
+      header.sizes_offset != kHeaderSize + n * kCorpusRecordSize ||
+      header.sizes_offset > reader->data_size_ ||
+      header.num_sizes >
+          (reader->data_size_ - header.sizes_offset) / sizeof(SizeEntry) ||
+      header.index_offset !=
+          header.sizes_offset + header.num_sizes * sizeof(SizeEntry) ||
+      header.index_offset + n * sizeof(std::uint32_t) != reader->data_size_) {
+    Fail(error, "'" + path + "' is not a valid corpus");
+    return nullptr;
+  }
+
+  reader->records_ = reinterpret_cast<const CorpusRecord*>(data + kHeaderSize);
+  reader->num_records_ = n;
+  reader->sizes_ =
+      reinterpret_cast<const SizeEntry*>(data + header.sizes_offset);
+  reader->num_sizes_ = header.num_sizes;
+  reader->index_ =
+      reinterpret_cast<const std::uint32_t*>(data + header.index_offset);
+
+  std::uint64_t total = 0;
+  for (std::size_t i = 0; i != reader->num_sizes_; ++i) {
+    const SizeEntry& entry = reader->sizes_[i];
+    if (entry.begin != total ||
+        (i != 0 && std::tie(reader->sizes_[i - 1].height,
+                            reader->sizes_[i - 1].width) >=
+                       std::tie(entry.height, entry.width))) {
+      Fail(error, "'" + path + "' has an invalid size directory");
+      return nullptr;
+    }
+    total += entry.count;
+  }
+  if (total != n) {
+    Fail(error, "'" + path + "' has an invalid size directory");
+    return nullptr;
+  }
+  return reader;
+}
+
+bool CorpusReader::VerifyIndex(std::string* error) const {
+  if (!std::all_of(index_, index_ + num_records_,
+                   [this](std::uint32_t i) { return i < num_records_; })) {
+    return Fail(error, "the corpus has an invalid index");
+  }
+  return true;
+}
+
+CorpusReader::~CorpusReader() {
+  if (data_ != nullptr) munmap(data_, data_size_);
+}
+
+CorpusReader::Span CorpusReader::BySize(int height, int width) const {
+  const SizeEntry* const end = sizes_ + num_sizes_;
+  const SizeEntry* it = std::lower_bound(
+      sizes_, end, std::pair(height, width),
+      [](const SizeEntry& entry, const std::pair<int, int>& size) {
+        return std::pair<int, int>(entry.height, entry.width) < size;
+      });
+  if (it == end || it->height != height || it->width != width) return {};
+  return {index_ + it->begin, index_ + it->begin + it->count};
+}
+
+CorpusReader::Span CorpusReader::BySizeAndLength(int height, int width,
+                                                 int min_length,
+                                                 int max_length) const {
+  // Only the entries visited by the binary searches are checked; an entry
+  // that is not a record number counts as a record of length 0.
+  const auto length = [this](std::uint32_t i) {
+    return i < num_records_ ? records_[i].max_length : 0;
+  };
+  const Span span = BySize(height, width);
+  const std::uint32_t* begin = std::partition_point(
+      span.begin(), span.end(), [&length, min_length](std::uint32_t i) {
+        return length(i) < min_length;
+      });
+  const std::uint32_t* end = std::partition_point(
+      begin, span.end(), [&length, max_length](std::uint32_t i) {
+        return length(i) <= max_length;
+      });
+  return {begin, end};
+}
+
+CorpusWriter::CorpusWriter(const std::string& path)
+    : path_(path), out_(path, std::ios::binary | std::ios::trunc) {
+  const Header header = {};
+  out_.write(reinterpret_cast<const char*>(&header), sizeof header);
+}
+
+CorpusWriter::~CorpusWriter() {
+  if (!finished_) Abort();
+}
+
+void CorpusWriter::Abort() {
+  finished_ = true;
+  out_.close();
+  out_.setstate(std::ios::failbit);
+  std::remove(path_.c_str());
+}
+
+bool CorpusWriter::Add(const Game& game, const LayoutStats& stats) {
+  if (finished_ || game.Height() * game.Width() > kCorpusMaxFields ||
+      game.Height() > std::numeric_limits<std::uint8_t>::max() ||
+      game.Width() > std::numeric_limits<std::uint8_t>::max() ||
+      keys_.size() == std::numeric_limits<std::uint32_t>::max()) {
+    return false;
+  }
+
+  CorpusRecord record = {};
+  record.height = game.Height();
+  record.width = game.Width();
+  record.num_starts = Clamp(stats.num_starts);
+  record.max_length = Clamp(stats.max_length);
+  record.max_branching = Clamp(stats.max_branching);
+  game.WriteLayoutAsBits(record.layout, 8);
+  int num_blocked = 0;
+  for (std::uint8_t b : record.layout) num_blocked += __builtin_popcount(b);
+  record.num_blocked = Clamp(num_blocked);
+
+  out_.write(reinterpret_cast<const char*>(&record), sizeof record);
+  keys_.push_back({record.height, record.width, record.max_length,
+                   record.max_branching,
+                   static_cast<std::uint32_t>(keys_.size())});
+  return ok();
+}
+
+bool CorpusWriter::Finish() {
+  if (finished_) return ok();
+  finished_ = true;
+
+  std::sort(keys_.begin(), keys_.end(), [](const Key& lhs, const Key& rhs) {
+    return std::tie(lhs.height, lhs.width, lhs.max_length, lhs.max_branching,
+                    lhs.record) < std::tie(rhs.height, rhs.width,
+                                           rhs.max_length, rhs.max_branching,
+                                           rhs.record);
+  });
+
+  std::uint32_t num_sizes = 0;
+  for (std::size_t i = 0; i != keys_.size();) {
+    std::size_t j = i;
+    while (j != keys_.size() && keys_[j].height == keys_[i].height &&
+           keys_[j].width == keys_[i].width) {
+      ++j;
+    }
+    const std::uint8_t entry[12] = {
+        keys_[i].height, keys_[i].width, 0, 0,
+        std::uint8_t(i), std::uint8_t(i >> 8), std::uint8_t(i >> 16),
+        std::uint8_t(i >> 24),
+        std::uint8_t(j - i), std::uint8_t((j - i) >> 8),
+        std::uint8_t((j - i) >> 16), std::uint8_t((j - i) >> 24)};
+    out_.write(reinterpret_cast<const char*>(entry), sizeof entry);
+    ++num_sizes;
+    i = j;
+  }
+
+  for (const Key& key : keys_) {
+    const std::uint8_t record[4] = {
+        std::uint8_t(key.record), std::uint8_t(key.record >> 8),
+        std::uint8_t(key.record >> 16), std::uint8_t(key.record >> 24)};
+    out_.write(reinterpret_cast<const char*>(record), sizeof record);
+  }
+
+  Header header = {};
+  std::copy(kMagic, kMagic + sizeof kMagic, header.magic);
+  header.version = kVersion;
+  header.record_size = kCorpusRecordSize;
+  header.num_records = keys_.size();
+  header.sizes_offset = kHeaderSize + keys_.size() * kCorpusRecordSize;
+  header.index_offset = header.sizes_offset + num_sizes * 12;
+  header.num_sizes = num_sizes;
+  out_.seekp(0);
+  out_.write(reinterpret_cast<const char*>(&header), sizeof header);
+  out_.close();
+  if (out_.fail()) {
+    std::remove(path_.c_str());
+    return false;
+  }
+  return true;
+}
+
+long ConvertCodesToCorpus(const std::string& in_path,
+                          const std::string& out_path, std::string* error) {
+  std::ifstream in(in_path);
+  if (!in) {
+    Fail(error, "cannot open '" + in_path + "'");
+    return -1;
+  }
+  // Unless Finish succeeds, the writer removes the output file again.
+  CorpusWriter writer(out_path);
+  if (!writer.ok()) {
+    Fail(error, "cannot write '" + out_path + "'");
+    return -1;
+  }
+
+  long line_number = 0;
+  for (std::string line; std::getline(in, line);) {
+    ++line_number;
+    line.erase(std::find_if(line.rbegin(), line.rend(),
+                            [](char c) { return !std::isspace(c); })
+                   .base(),
+               line.end());
+    if (line.empty() || line[0] == '#') continue;
+    const std::unique_ptr<Game> game = LoadFromHexString(line);
+    if (game == nullptr || !writer.Add(*game)) {
+      Fail(error, in_path + ":" + std::to_string(line_number) +
+                      ": cannot add '" + line + "'");
+      return -1;
+    }
+  }
+  if (!writer.Finish()) {
+    Fail(error, "cannot write '" + out_path + "'");
+    return -1;
+  }
+  return writer.size();
+}
+
+}  //  namespace tkware::lightgame
@@ -0,0 +1,202 @@
+// Copyright 2019 by Thomas Köppe
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef H_TKWARE_LIGHTGAME_GAME_CORPUS_
+#define H_TKWARE_LIGHTGAME_GAME_CORPUS_
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "game.h"
+#include "game_generate.h"
+
+namespace tkware::lightgame {
+
+// A corpus is a binary file of puzzle layouts that is memory-mapped for use,
+// so that opening it and accessing any layout take constant time, regardless
+// of the number of layouts; opening it only reads the header and the size
+// directory. The file consists of:
+//
+// * A 64-byte header: the magic "LGCORPUS", the format version and the
+//   record size (uint32 each), the number of records, and the offsets of the
+//   size directory and of the index (uint64 each), and the number of entries
+//   in the size directory (uint32).
+// * The records, of kCorpusRecordSize bytes each, see CorpusRecord.
+// * The size directory: one entry per board size (height, width (uint8
+//   each), two reserved bytes, and the position and count of the records of
+//   that size in the index (uint32 each)), sorted by size.
+// * The index: the numbers of all records (uint32 each), grouped by size as
+//   in the directory, and within each size sorted by difficulty, i.e. by the
+//   maximal length of a solution, then by the maximal branching, then by
+//   record number.
+//
+// All integers are little-endian, and the reader assumes a little-endian host.
+
+constexpr std::size_t kCorpusRecordSize = 40;
+
+// The largest number of fields of a layout in a corpus.
+constexpr int kCorpusMaxFields = 256;
+
+// A record of the corpus, as it is stored in the file.
+struct CorpusRecord {
+  std::uint8_t height;
+  std::uint8_t width;
+  std::uint8_t num_blocked;
+  std::uint8_t num_starts;     // as in LayoutStats
+  std::uint8_t max_length;     // as in LayoutStats
+  std::uint8_t max_branching;  // as in LayoutStats
+  std::uint8_t reserved[2];
+
+  // The blocked fields, one bit each in row-major order, as written by
+  // Game::WriteLayoutAsBits with 8 bits per byte.
+  std::uint8_t layout[kCorpusMaxFields / 8];
+
+  // Returns a new game with the layout of this record, or null if the record
+  // is invalid.
+  std::unique_ptr<Game> ToGame() const;
+};
+
+static_assert(sizeof(CorpusRecord) == kCorpusRecordSize);
+
+// A read-only view of a corpus file.
+class CorpusReader {
+ public:
+  // A range of record numbers.
+  class Span {
+   public:
+    Span() = default;
+    Span(const std::uint32_t* begin, const std::uint32_t* end)
+        : begin_(begin), end_(end) {}
+
+    const std::uint32_t* begin() const { return begin_; }
+    const std::uint32_t* end() const { return end_; }
+    std::size_t size() const { return end_ - begin_; }
+    bool empty() const { return begin_ == end_; }
+    std::uint32_t operator[](std::size_t i) const { return begin_[i]; }
+
+   private:
+    const std::uint32_t* begin_ = nullptr;
+    const std::uint32_t* end_ = nullptr;
+  };
+
+  // Maps the corpus file at path. The header and the size directory are
+  // checked, the index and the records are not (see VerifyIndex); returns
+  // null (and sets *error, if error is not null) if they are invalid or the
+  // file cannot be mapped.
+  static std::unique_ptr<CorpusReader> Open(const std::string& path,
+                                            std::string* error = nullptr);
+
+  // Checks that every entry of the index is a record number, which takes
+  // time linear in the size of the corpus. Returns false (and sets *error, if
+  // error is not null) otherwise. Record numbers from BySize and
+  // BySizeAndLength of a corpus that was not verified must be checked
+  // against size() before they are used.
+  bool VerifyIndex(std::string* error = nullptr) const;
+
+  ~CorpusReader();
+
+  CorpusReader(const CorpusReader&) = delete;
+  CorpusReader& operator=(const CorpusReader&) = delete;
+
+  std::size_t size() const { return num_records_; }
+
+  const CorpusRecord& operator[](std::size_t i) const { return records_[i]; }
+
+  // Returns the numbers of all records of the given size, ordered by
+  // difficulty (see above).
+  Span BySize(int height, int width) const;
+
+  // Returns the numbers of the records of the given size whose maximal
+  // solution length lies in [min_length, max_length], ordered by difficulty.
+  Span BySizeAndLength(int height, int width, int min_length,
+                       int max_length) const;
+
+ private:
+  struct SizeEntry {
+    std::uint8_t height;
+    std::uint8_t width;
+    std::uint8_t reserved[2];
+    std::uint32_t begin;
+    std::uint32_t count;
+  };
+
+  CorpusReader() = default;
+
+  void* data_ = nullptr;
+  std::size_t data_size_ = 0;
+
+  const CorpusRecord* records_ = nullptr;
+  std::size_t num_records_ = 0;
+  const SizeEntry* sizes_ = nullptr;
+  std::size_t num_sizes_ = 0;
+  const std::uint32_t* index_ = nullptr;
+};
+
+// Writes a corpus file. Records are written as they are added; only a few
+// bytes of index data per record are kept in memory until Finish.
+class CorpusWriter {
+ public:
+  // Creates the corpus file at path (replacing any existing file); check
+  // ok() for success.
+  explicit CorpusWriter(const std::string& path);
+
+  // Calls Abort, unless Finish has been called: a corpus that was not
+  // completed explicitly is not left behind.
+  ~CorpusWriter();
+
+  // Appends the layout of the game, with the given statistics (see
+  // ComputeLayoutStats). Returns false if the layout has more than
+  // kCorpusMaxFields fields, if the corpus already has 2^32 - 1 records, or
+  // on error.
+  bool Add(const Game& game, const LayoutStats& stats);
+  bool Add(const Game& game) { return Add(game, ComputeLayoutStats(game)); }
+
+  // Writes the size directory and the index, and completes the header.
+  // Returns false on error, in which case the file is removed. No records may
+  // be added afterwards.
+  bool Finish();
+
+  // Closes and removes the file. No records may be added afterwards.
+  void Abort();
+
+  bool ok() const { return static_cast<bool>(out_); }
+  std::size_t size() const { return keys_.size(); }
+
+ private:
+  struct Key {
+    std::uint8_t height, width, max_length, max_branching;
+    std::uint32_t record;
+  };
+
+  const std::string path_;
+  std::ofstream out_;
+  std::vector<Key> keys_;
+  bool finished_ = false;
+};
+
+// Converts a list of level codes, one per line (blank lines and lines
+// starting with '#' are skipped), to a corpus file, computing the statistics
+// of each layout. Returns the number of layouts written, or -1 on error, in
+// which case *error (if not null) describes the error.
+long ConvertCodesToCorpus(const std::string& in_path,
+                          const std::string& out_path,
+                          std::string* error = nullptr);
+
+}  //  namespace tkware::lightgame
+
+#endif  // H_TKWARE_LIGHTGAME_GAME_CORPUS_
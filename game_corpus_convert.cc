@@ -0,0 +1,44 @@
+// Copyright 2019 by Thomas Köppe
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Conversion of a list of level codes to a corpus file (see game_corpus.h).
+//
+// Usage: game_corpus_convert INPUT OUTPUT
+//
+// INPUT has one level code per line, like the GOOD_GAMES file. The statistics
+// of every layout are computed with the solver, which may take a while for
+// large lists.
+
+#include <iostream>
+#include <string>
+
+#include "game_corpus.h"
+
+int main(int argc, char* argv[]) {
+  if (argc != 3) {
+    std::cerr << "Usage: " << argv[0] << " INPUT OUTPUT\n";
+    return 1;
+  }
+
+  std::string error;
+  const long n =
+      tkware::lightgame::ConvertCodesToCorpus(argv[1], argv[2], &error);
+  if (n < 0) {
+    std::cerr << error << "\n";
+    return 1;
+  }
+  std::cout << "Wrote " << n << " layouts to " << argv[2] << ".\n";
+}
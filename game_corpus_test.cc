@@ -0,0 +1,234 @@
+#include "game_corpus.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "game.h"
+#include "game_generate.h"
+#include "gtest/gtest.h"
+
+namespace tkware::lightgame {
+namespace {
+
+std::string TempPath(const std::string& name) {
+  const char* dir = std::getenv("TEST_TMPDIR");
+  return std::string(dir != nullptr ? dir : "/tmp") + "/" + name;
+}
+
+std::vector<std::uint32_t> ToVector(CorpusReader::Span span) {
+  return std::vector<std::uint32_t>(span.begin(), span.end());
+}
+
+TEST(Corpus, RoundTrip) {
+  const std::string path = TempPath("corpus_round_trip");
+  const std::vector<std::string> codes = {
+      "6902400412202000", "75040208103",      "778011A01203040",
+      "6914888000000000", "8700204008058000", "110",
+      "6980440062005002"};
+  std::vector<LayoutStats> stats;
+  {
+    CorpusWriter writer(path);
+    ASSERT_TRUE(writer.ok());
+    for (const std::string& code : codes) {
+      std::unique_ptr<Game> game = LoadFromHexString(code);
+      ASSERT_NE(game, nullptr) << code;
+      stats.push_back(ComputeLayoutStats(*game));
+      ASSERT_TRUE(writer.Add(*game, stats.back()));
+    }
+    EXPECT_TRUE(writer.Add(Game(16, 16), LayoutStats()));
+    EXPECT_FALSE(writer.Add(Game(16, 17), LayoutStats()));
+    ASSERT_TRUE(writer.Finish());
+    EXPECT_EQ(writer.size(), 8);
+    EXPECT_FALSE(writer.Add(Game(3, 3), LayoutStats()));
+  }
+
+  std::string error;
+  std::unique_ptr<CorpusReader> reader = CorpusReader::Open(path, &error);
+  ASSERT_NE(reader, nullptr) << error;
+  ASSERT_EQ(reader->size(), codes.size() + 1);
+  for (std::size_t i = 0; i != codes.size(); ++i) {
+    const CorpusRecord& record = (*reader)[i];
+    std::unique_ptr<Game> game = record.ToGame();
+    ASSERT_NE(game, nullptr);
+    EXPECT_EQ(SaveToHexString(*game),
+              SaveToHexString(*LoadFromHexString(codes[i])));
+    EXPECT_EQ(record.num_starts, stats[i].num_starts);
+    EXPECT_EQ(record.max_length, stats[i].max_length);
+    EXPECT_EQ(record.max_branching, stats[i].max_branching);
+    EXPECT_EQ(record.num_blocked,
+              record.height * record.width - stats[i].num_fields);
+  }
+  EXPECT_EQ((*reader)[7].height, 16);
+  EXPECT_EQ((*reader)[7].width, 16);
+  EXPECT_EQ((*reader)[7].num_blocked, 0);
+  std::remove(path.c_str());
+}
+
+TEST(Corpus, Indexes) {
+  const std::string path = TempPath("corpus_indexes");
+  {
+    // Only the statistics matter for the indexes.
+    CorpusWriter writer(path);
+    for (int length : {5, 2, 7, 2, 9}) {
+      LayoutStats stats;
+      stats.max_length = length;
+      stats.max_branching = 10 - length;
+      ASSERT_TRUE(writer.Add(Game(4, 4), stats));
+    }
+    LayoutStats stats;
+    stats.max_length = 3;
+    ASSERT_TRUE(writer.Add(Game(2, 3), stats));
+    ASSERT_TRUE(writer.Finish());
+  }
+
+  std::unique_ptr<CorpusReader> reader = CorpusReader::Open(path);
+  ASSERT_NE(reader, nullptr);
+  EXPECT_EQ(ToVector(reader->BySize(4, 4)),
+            (std::vector<std::uint32_t>{1, 3, 0, 2, 4}));
+  EXPECT_EQ(ToVector(reader->BySize(2, 3)), std::vector<std::uint32_t>{5});
+  EXPECT_TRUE(reader->BySize(3, 2).empty());
+  EXPECT_TRUE(reader->BySize(5, 5).empty());
+
+  EXPECT_EQ(ToVector(reader->BySizeAndLength(4, 4, 3, 7)),
+            (std::vector<std::uint32_t>{0, 2}));
+  EXPECT_EQ(ToVector(reader->BySizeAndLength(4, 4, 0, 2)),
+            (std::vector<std::uint32_t>{1, 3}));
+  EXPECT_EQ(ToVector(reader->BySizeAndLength(4, 4, 9, 100)),
+            std::vector<std::uint32_t>{4});
+  EXPECT_TRUE(reader->BySizeAndLength(4, 4, 10, 100).empty());
+  EXPECT_TRUE(reader->BySizeAndLength(4, 4, 6, 4).empty());
+  std::remove(path.c_str());
+}
+
+TEST(Corpus, Empty) {
+  const std::string path = TempPath("corpus_empty");
+  ASSERT_TRUE(CorpusWriter(path).Finish());
+  std::unique_ptr<CorpusReader> reader = CorpusReader::Open(path);
+  ASSERT_NE(reader, nullptr);
+  EXPECT_EQ(reader->size(), 0);
+  EXPECT_TRUE(reader->BySize(3, 3).empty());
+  std::remove(path.c_str());
+}
+
+TEST(Corpus, BadFiles) {
+  const std::string path = TempPath("corpus_bad");
+  std::string error;
+  EXPECT_EQ(CorpusReader::Open(path + "_missing", &error), nullptr);
+  EXPECT_NE(error, "");
+
+  std::ofstream(path) << "6902400412202000\n";
+  EXPECT_EQ(CorpusReader::Open(path), nullptr);
+
+  {
+    CorpusWriter writer(path);
+    ASSERT_TRUE(writer.Add(Game(3, 3)));
+    ASSERT_TRUE(writer.Finish());
+  }
+  std::string data;
+  {
+    std::ifstream in(path, std::ios::binary);
+    data.assign(std::istreambuf_iterator<char>(in), {});
+  }
+  ASSERT_NE(CorpusReader::Open(path), nullptr);
+  EXPECT_TRUE(CorpusReader::Open(path)->VerifyIndex());
+
+  // Truncated.
+  std::ofstream(path, std::ios::binary) << data.substr(0, data.size() - 1);
+  EXPECT_EQ(CorpusReader::Open(path), nullptr);
+
+  // A size directory whose counts do not add up.
+  std::string bad = data;
+  bad[bad.size() - 4 - 4] = 2;
+  std::ofstream(path, std::ios::binary) << bad;
+  EXPECT_EQ(CorpusReader::Open(path), nullptr);
+
+  // Wrong version.
+  bad = data;
+  bad[8] = 2;
+  std::ofstream(path, std::ios::binary) << bad;
+  EXPECT_EQ(CorpusReader::Open(path), nullptr);
+
+  // A size directory that is larger than the file.
+  bad = data;
+  bad[40] = bad[41] = bad[42] = bad[43] = '\xFF';
+  std::ofstream(path, std::ios::binary) << bad;
+  EXPECT_EQ(CorpusReader::Open(path), nullptr);
+
+  // An index entry that is not a record number is only found on request.
+  bad = data;
+  bad[bad.size() - 4] = 1;
+  std::ofstream(path, std::ios::binary) << bad;
+  std::unique_ptr<CorpusReader> reader = CorpusReader::Open(path);
+  ASSERT_NE(reader, nullptr);
+  EXPECT_EQ(ToVector(reader->BySize(3, 3)), std::vector<std::uint32_t>{1});
+  EXPECT_EQ(ToVector(reader->BySizeAndLength(3, 3, 0, 0)),
+            std::vector<std::uint32_t>{1});
+  EXPECT_FALSE(reader->VerifyIndex(&error));
+  EXPECT_NE(error.find("invalid index"), std::string::npos) << error;
+  reader.reset();
+  std::remove(path.c_str());
+}
+
+TEST(Corpus, Abort) {
+  const std::string path = TempPath("corpus_abort");
+  {
+    CorpusWriter writer(path);
+    ASSERT_TRUE(writer.Add(Game(3, 3)));
+  }
+  EXPECT_FALSE(std::ifstream(path).good());
+
+  CorpusWriter writer(path);
+  ASSERT_TRUE(writer.Add(Game(3, 3)));
+  writer.Abort();
+  EXPECT_FALSE(std::ifstream(path).good());
+  EXPECT_FALSE(writer.Add(Game(3, 3)));
+  EXPECT_FALSE(writer.Finish());
+}
+
+TEST(Corpus, InvalidRecord) {
+  CorpusRecord record = {};
+  EXPECT_EQ(record.ToGame(), nullptr);
+  record.height = 16;
+  record.width = 17;
+  EXPECT_EQ(record.ToGame(), nullptr);
+  record.width = 16;
+  EXPECT_NE(record.ToGame(), nullptr);
+}
+
+TEST(ConvertCodesToCorpus, Codes) {
+  const std::string in_path = TempPath("corpus_codes");
+  const std::string out_path = TempPath("corpus_codes_out");
+  std::ofstream(in_path) << "# Good games.\n"
+                            "6902400412202000\n"
+                            "\n"
+                            "778011A01203040  \n"
+                            "79489204108c000000\n";
+  std::string error;
+  EXPECT_EQ(ConvertCodesToCorpus(in_path, out_path, &error), 3) << error;
+
+  std::unique_ptr<CorpusReader> reader = CorpusReader::Open(out_path);
+  ASSERT_NE(reader, nullptr);
+  ASSERT_EQ(reader->size(), 3);
+  EXPECT_EQ(SaveToHexString(*(*reader)[1].ToGame()),
+            SaveToHexString(*LoadFromHexString("778011A01203040")));
+  EXPECT_EQ(reader->BySize(7, 7).size(), 1);
+  for (std::size_t i = 0; i != reader->size(); ++i) {
+    EXPECT_GT((*reader)[i].num_starts, 0);
+  }
+
+  std::ofstream(in_path) << "6902400412202000\nnot a code\n";
+  EXPECT_EQ(ConvertCodesToCorpus(in_path, out_path, &error), -1);
+  EXPECT_NE(error.find(":2:"), std::string::npos) << error;
+  EXPECT_EQ(CorpusReader::Open(out_path), nullptr);
+  EXPECT_EQ(ConvertCodesToCorpus(in_path + "_missing", out_path), -1);
+  std::remove(in_path.c_str());
+  std::remove(out_path.c_str());
+}
+
+}  // namespace
+}  // namespace tkware::lightgame
@@ -0,0 +1,406 @@
+// Copyright 2019 by Thomas Köppe
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Exhaustive enumeration of all layouts of a given size.
+//
+// Usage: game_enumerate --height=H --width=W --dir=DIR [--shards=N]
+//                       [--threads=N]
+//        game_enumerate --dir=DIR --aggregate [--top=K]
+//
+// The first form solves every layout of dimensions H times W (with at most 32
+// fields) and writes the results to DIR, which must exist. Layouts are
+// identified by the bitmask of their blocked fields (bit x - 1 + W * (y - 1)
+// for field x, y). Of each set of layouts that are mirror images or rotations
+// of one another, only the one with the smallest mask (the canonical layout)
+// is solved. The masks are visited in Gray-code order, so that consecutive
+// layouts differ in a single field, and the index space is split into N
+// shards (default 256) that are processed by the given number of threads
+// (default: one per core).
+//
+// Each shard i writes one record per solvable canonical layout to
+// DIR/shard-<i>.bin, and its progress to DIR/shard-<i>.ckpt, at regular
+// intervals and on SIGINT/SIGTERM. Running the same command again resumes
+// every shard from its last checkpoint and discards any records written after
+// it.
+//
+// A record consists of 8 bytes: the mask (32 bits, little-endian), the number
+// of winning starts, the greatest length and the greatest branching of the
+// winning sequences (see LayoutStats), and the number of distinct layouts
+// that are symmetric to it (including itself).
+//
+// The second form reads the results in DIR and prints summary statistics: the
+// solvable fraction, the distribution of the number of winning starts, and the
+// K hardest layouts (default 10).
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "game.h"
+#include "game_generate.h"
+
+namespace tkware::lightgame {
+namespace {
+
+constexpr std::size_t kRecordSize = 8;
+constexpr std::uint64_t kCheckpointInterval = 1 << 16;
+
+volatile std::sig_atomic_t interrupted = 0;
+
+void HandleSignal(int) { interrupted = 1; }
+
+// The symmetries of a board, as permutations of the bits of a mask.
+class Symmetries {
+ public:
+  Symmetries(int height, int width) {
+    // Mirror images and half turns exist for every board; quarter turns and
+    // reflections across the diagonals only for square boards.
+    const int num_transforms = height == width ? 8 : 4;
+    for (int t = 0; t != num_transforms; ++t) {
+      std::vector<int>& perm = perms_.emplace_back(height * width);
+      for (int y = 0; y != height; ++y) {
+        for (int x = 0; x != width; ++x) {
+          int tx = (t & 1) ? width - 1 - x : x;
+          int ty = (t & 2) ? height - 1 - y : y;
+          if (t & 4) std::swap(tx, ty);
+          perm[x + width * y] = tx + width * ty;
+        }
+      }
+    }
+  }
+
+  std::uint32_t Apply(std::size_t t, std::uint32_t mask) const {
+    std::uint32_t result = 0;
+    for (std::size_t i = 0; i != perms_[t].size(); ++i) {
+      result |= ((mask >> i) & 1U) << perms_[t][i];
+    }
+    return result;
+  }
+
+  bool IsCanonical(std::uint32_t mask) const {
+    for (std::size_t t = 1; t != perms_.size(); ++t) {
+      if (Apply(t, mask) < mask) return false;
+    }
+    return true;
+  }
+
+  int OrbitSize(std::uint32_t mask) const {
+    std::vector<std::uint32_t> images;
+    for (std::size_t t = 0; t != perms_.size(); ++t) {
+      images.push_back(Apply(t, mask));
+    }
+    std::sort(images.begin(), images.end());
+    return std::unique(images.begin(), images.end()) - images.begin();
+  }
+
+ private:
+  std::vector<std::vector<int>> perms_;
+};
+
+struct Config {
+  int height = 0;
+  int width = 0;
+  int num_shards = 256;
+};
+
+std::string ShardPath(const std::string& dir, int shard, const char* ext) {
+  return dir + "/shard-" + std::to_string(shard) + ext;
+}
+
+// The progress of a shard: the next index to visit, and the number of bytes
+// of records written for all indices before it.
+struct Checkpoint {
+  std::uint64_t next;
+  std::uint64_t bytes;
+};
+
+bool ReadCheckpoint(const std::string& path, Checkpoint* checkpoint) {
+  std::ifstream in(path);
+  return static_cast<bool>(in >> checkpoint->next >> checkpoint->bytes);
+}
+
+bool WriteCheckpoint(const std::string& path, const Checkpoint& checkpoint) {
+  // Write to a temporary file first, so that an interrupted write does not
+  // destroy the previous checkpoint.
+  const std::string tmp_path = path + ".tmp";
+  {
+    std::ofstream out(tmp_path);
+    out << checkpoint.next << ' ' << checkpoint.bytes << '\n';
+    if (!out.flush()) return false;
+  }
+  return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+// Enumerates the indices [begin, end) of the shard, resuming from its
+// checkpoint if there is one. Returns false on I/O errors.
+bool RunShard(const Config& config, const Symmetries& symmetries,
+              const std::string& dir, int shard, std::uint64_t begin,
+              std::uint64_t end) {
+  const std::string bin_path = ShardPath(dir, shard, ".bin");
+  const std::string ckpt_path = ShardPath(dir, shard, ".ckpt");
+
+  Checkpoint checkpoint = {begin, 0};
+  if (ReadCheckpoint(ckpt_path, &checkpoint)) {
+    if (checkpoint.next == end) return true;
+    if (checkpoint.next < begin || checkpoint.next > end) return false;
+  }
+
+  // Discard any records written after the checkpoint.
+  {
+    std::ofstream touch(bin_path, std::ios::binary | std::ios::app);
+  }
+  if (::truncate(bin_path.c_str(), checkpoint.bytes) != 0) return false;
+  std::ofstream out(bin_path, std::ios::binary | std::ios::app);
+
+  // The board is kept in sync with the mask, one field at a time.
+  Game game(config.height, config.width);
+  auto at = [&game, &config](int bit) -> Game::State& {
+    return game.At(bit % config.width + 1, bit / config.width + 1);
+  };
+  std::uint32_t mask = checkpoint.next ^ (checkpoint.next >> 1);
+  for (int bit = 0; bit != config.height * config.width; ++bit) {
+    if ((mask >> bit) & 1U) at(bit) = Game::State::kBlocked;
+  }
+
+  std::uint64_t i = checkpoint.next;
+  while (i != end && !interrupted) {
+    if (symmetries.IsCanonical(mask)) {
+      if (const LayoutStats stats = ComputeLayoutStats(&game);
+          stats.num_starts != 0) {
+        const unsigned char record[kRecordSize] = {
+            static_cast<unsigned char>(mask),
+            static_cast<unsigned char>(mask >> 8),
+            static_cast<unsigned char>(mask >> 16),
+            static_cast<unsigned char>(mask >> 24),
+            static_cast<unsigned char>(stats.num_starts),
+            static_cast<unsigned char>(std::min(stats.max_length, 255)),
+            static_cast<unsigned char>(std::min(stats.max_branching, 255)),
+            static_cast<unsigned char>(symmetries.OrbitSize(mask))};
+        out.write(reinterpret_cast<const char*>(record), kRecordSize);
+        checkpoint.bytes += kRecordSize;
+      }
+    }
+
+    // Step to the next Gray code, which differs in the lowest set bit of i.
+    if (++i == end) break;
+    const int bit = __builtin_ctzll(i);
+    mask ^= 1U << bit;
+    at(bit) = (mask >> bit) & 1U ? Game::State::kBlocked : Game::State::kOff;
+
+    if (i % kCheckpointInterval == 0) {
+      checkpoint.next = i;
+      if (!out.flush() || !WriteCheckpoint(ckpt_path, checkpoint)) {
+        return false;
+      }
+    }
+  }
+
+  checkpoint.next = i;
+  return out.flush() && WriteCheckpoint(ckpt_path, checkpoint);
+}
+
+bool ReadConfig(const std::string& dir, Config* config) {
+  std::ifstream in(dir + "/config");
+  return static_cast<bool>(in >> config->height >> config->width >>
+                           config->num_shards);
+}
+
+int Enumerate(const Config& config, const std::string& dir, int num_threads) {
+  if (Config existing; ReadConfig(dir, &existing)) {
+    if (existing.height != config.height || existing.width != config.width ||
+        existing.num_shards != config.num_shards) {
+      std::cerr << "Directory " << dir << " holds results for "
+                << existing.height << " x " << existing.width << " with "
+                << existing.num_shards << " shards.\n";
+      return 1;
+    }
+  } else {
+    std::ofstream out(dir + "/config");
+    out << config.height << ' ' << config.width << ' ' << config.num_shards
+        << '\n';
+    if (!out.flush()) {
+      std::cerr << "Cannot write to directory " << dir << ".\n";
+      return 1;
+    }
+  }
+
+  std::signal(SIGINT, HandleSignal);
+  std::signal(SIGTERM, HandleSignal);
+
+  const Symmetries symmetries(config.height, config.width);
+  const std::uint64_t total = std::uint64_t{1}
+                               << (config.height * config.width);
+  std::atomic<int> next_shard{0};
+  std::atomic<bool> failed{false};
+
+  auto work = [&]() {
+    for (int shard;
+         !interrupted && (shard = next_shard++) < config.num_shards;) {
+      const std::uint64_t begin = total * shard / config.num_shards;
+      const std::uint64_t end = total * (shard + 1) / config.num_shards;
+      if (!RunShard(config, symmetries, dir, shard, begin, end)) {
+        std::cerr << "I/O error in shard " << shard << ".\n";
+        failed = true;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 1; i < num_threads; ++i) threads.emplace_back(work);
+  work();
+  for (std::thread& t : threads) t.join();
+
+  if (failed) return 1;
+  if (interrupted) {
+    std::cerr << "Interrupted; run again to resume.\n";
+    return 2;
+  }
+  std::cout << "Enumerated all " << total << " layouts of " << config.height
+            << " x " << config.width << ".\n";
+  return 0;
+}
+
+int Aggregate(const std::string& dir, int top) {
+  Config config;
+  if (!ReadConfig(dir, &config)) {
+    std::cerr << "No results in directory " << dir << ".\n";
+    return 1;
+  }
+
+  // Counts include all symmetric copies, so they refer to all layouts.
+  const std::uint64_t total = std::uint64_t{1}
+                               << (config.height * config.width);
+  std::uint64_t num_solvable = 0, num_complete = 0;
+  std::map<int, std::uint64_t> starts_histogram;
+
+  // The hardest layouts: most branching, then longest, then fewest starts,
+  // i.e. the smallest entries. Only the top ones are kept, in a heap whose
+  // root is the least hard of them.
+  using Entry = std::tuple<int, int, int, std::uint32_t>;
+  std::priority_queue<Entry> hardest;
+
+  for (int shard = 0; shard != config.num_shards; ++shard) {
+    if (Checkpoint c; ReadCheckpoint(ShardPath(dir, shard, ".ckpt"), &c) &&
+                      c.next == total * (shard + 1) / config.num_shards) {
+      ++num_complete;
+    }
+    std::ifstream in(ShardPath(dir, shard, ".bin"), std::ios::binary);
+    for (unsigned char r[kRecordSize];
+         in.read(reinterpret_cast<char*>(r), kRecordSize);) {
+      const std::uint32_t mask = r[0] | r[1] << 8 | r[2] << 16 |
+                                 std::uint32_t{r[3]} << 24;
+      num_solvable += r[7];
+      starts_histogram[r[4]] += r[7];
+      const Entry entry(-r[6], -r[5], r[4], mask);
+      if (hardest.size() < static_cast<std::size_t>(top)) {
+        hardest.push(entry);
+      } else if (top != 0 && entry < hardest.top()) {
+        hardest.pop();
+        hardest.push(entry);
+      }
+    }
+  }
+  std::vector<Entry> sorted(hardest.size());
+  for (auto it = sorted.rbegin(); it != sorted.rend(); ++it) {
+    *it = hardest.top();
+    hardest.pop();
+  }
+
+  std::cout << "Layouts of " << config.height << " x " << config.width << ": "
+            << total << " (" << num_complete << " of " << config.num_shards
+            << " shards complete)\n"
+            << "Solvable: " << num_solvable << " ("
+            << 100.0 * num_solvable / total << "%)\n"
+            << "Winning starts:\n";
+  for (const auto& [starts, count] : starts_histogram) {
+    std::cout << "  " << starts << ": " << count << "\n";
+  }
+  std::cout << "Hardest layouts (branching, length, starts, code):\n";
+  for (const auto& [branching, length, starts, mask] : sorted) {
+    Game game(config.height, config.width);
+    for (int bit = 0; bit != config.height * config.width; ++bit) {
+      if ((mask >> bit) & 1U) {
+        game.SetBlocked(bit % config.width + 1, bit / config.width + 1);
+      }
+    }
+    std::cout << "  " << -branching << " " << -length << " " << starts << " "
+              << SaveToHexString(game) << "\n";
+  }
+  return 0;
+}
+
+bool ParseFlag(const std::string& arg, const std::string& name, int* value) {
+  const std::string prefix = "--" + name + "=";
+  if (arg.rfind(prefix, 0) != 0) return false;
+  std::istringstream iss(arg.substr(prefix.size()));
+  return (iss >> *value) && (iss >> std::ws).eof();
+}
+
+int Run(int argc, char* argv[]) {
+  Config config;
+  std::string dir;
+  bool aggregate = false;
+  int num_threads = std::max(1U, std::thread::hardware_concurrency());
+  int top = 10;
+
+  for (int i = 1; i != argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg.rfind("--dir=", 0) == 0) {
+      dir = arg.substr(6);
+    } else if (arg == "--aggregate") {
+      aggregate = true;
+    } else if (!(ParseFlag(arg, "height", &config.height) &&
+                 config.height > 0) &&
+               !(ParseFlag(arg, "width", &config.width) && config.width > 0) &&
+               !(ParseFlag(arg, "shards", &config.num_shards) &&
+                 config.num_shards > 0) &&
+               !(ParseFlag(arg, "threads", &num_threads) && num_threads > 0) &&
+               !(ParseFlag(arg, "top", &top) && top >= 0)) {
+      dir.clear();
+      break;
+    }
+  }
+
+  if (!dir.empty() && aggregate) return Aggregate(dir, top);
+  if (dir.empty() || config.height * config.width == 0 ||
+      config.height * config.width > 32) {
+    std::cerr << "Usage: " << argv[0]
+              << " --height=H --width=W --dir=DIR [--shards=N] [--threads=N]\n"
+              << "       " << argv[0] << " --dir=DIR --aggregate [--top=K]\n";
+    return 1;
+  }
+  return Enumerate(config, dir, num_threads);
+}
+
+}  // namespace
+}  // namespace tkware::lightgame
+
+int main(int argc, char* argv[]) {
+  return tkware::lightgame::Run(argc, argv);
+}
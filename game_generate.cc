@@ -0,0 +1,487 @@
+// Copyright 2019 by Thomas Köppe
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "game_generate.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "game.h"
+#include "game_trace.h"
+
+namespace tkware::lightgame {
+
+std::uint64_t CounterRng::Below(std::uint64_t bound) {
+  // Reject the lowest 2^64 mod bound values, which would otherwise make the
+  // low results slightly more likely.
+  const std::uint64_t threshold = -bound % bound;
+  for (;;) {
+    if (std::uint64_t r = (*this)(); r >= threshold) return r % bound;
+  }
+}
+
+namespace {
+
+// Sets *picked to n of the given fields, chosen by a partial Fisher-Yates
+// shuffle driven by rng.
+void PickFields(const std::vector<Game::Coord>& fields, int n, CounterRng rng,
+                std::vector<Game::Coord>* picked) {
+  *picked = fields;
+  for (int k = 0; k != n; ++k) {
+    std::swap((*picked)[k], (*picked)[k + rng.Below(picked->size() - k)]);
+  }
+  picked->resize(n);
+}
+
+// Returns how far the stats are from meeting the target; zero if they do.
+int Distance(const LayoutStats& stats, const GenerationTarget& target) {
+  auto outside = [](int value, int lo, int hi) {
+    return value < lo ? lo - value : value > hi ? value - hi : 0;
+  };
+  const int lo = target.all_starts ? stats.num_fields : target.min_starts;
+  const int hi = target.all_starts ? stats.num_fields : target.max_starts;
+
+  // The number of starts weighs most, since nothing else is meaningful before
+  // there are any. Defects measure how far an unsolvable layout is from being
+  // solvable at all.
+  return 4 * outside(stats.num_starts, lo, hi) + 2 * stats.num_defects +
+         outside(stats.max_length, target.min_length, target.max_length) +
+         outside(stats.max_branching, target.min_branching,
+                 target.max_branching);
+}
+
+// Grows random winning paths over the free fields of a layout, as described
+// for GenerateFromPath. The board is padded like that of Game.
+class PathGrower {
+ public:
+  struct Path {
+    std::vector<Game::State> board;  // with the fields that it requires blocked
+    int start = 0;
+    std::vector<int> moves;  // the index into offsets_ of each move
+    int num_blocks = 0;      // the number of fields that it requires blocked
+  };
+
+  explicit PathGrower(const Game& game)
+      : stride_(game.Width() + 2),
+        offsets_{-stride_, +stride_, -1, +1},
+        layout_((game.Height() + 2) * stride_, Game::State::kBlocked),
+        seen_(layout_.size()) {
+    for (int y = 1; y <= game.Height(); ++y) {
+      for (int x = 1; x <= game.Width(); ++x) {
+        if (game.At(x, y) == Game::State::kOff) {
+          layout_[x + stride_ * y] = Game::State::kOff;
+          free_.push_back(x + stride_ * y);
+        }
+      }
+    }
+  }
+
+  bool HasFreeFields() const { return !free_.empty(); }
+
+  // Grows a new path into *path.
+  void Grow(std::mt19937* rbg, Path* path) {
+    std::vector<Game::State>& board = path->board;
+    board = layout_;
+    int pos = free_[std::uniform_int_distribution<std::size_t>(
+        0, free_.size() - 1)(*rbg)];
+    board[pos] = Game::State::kOn;
+    path->start = pos;
+    path->moves.clear();
+    path->num_blocks = 0;
+    int num_open = free_.size() - 1;
+
+    for (;;) {
+      // Picks one of the moves that cost the least. Moves that stop short are
+      // only considered if every other move cuts off fields.
+      candidates_.clear();
+      int best = -1;
+      auto consider = [&](int d, int length, int run) {
+        const int cost = Cost(&board, num_open, pos, d, length, run);
+        if (best < 0 || cost < best) {
+          best = cost;
+          candidates_.clear();
+        }
+        if (cost == best) candidates_.push_back({d, length});
+      };
+      for (bool stop_short : {false, true}) {
+        if (stop_short && best <= 0) break;
+        for (int d = 0; d != 4; ++d) {
+          int run = 0;
+          while (board[pos + offsets_[d] * (run + 1)] == Game::State::kOff) {
+            ++run;
+          }
+          if (run == 0) continue;
+          if (!stop_short) {
+            consider(d, run, run);
+          } else {
+            if (run > 1) consider(d, run - 1, run);
+            if (run > 2) consider(d, 1, run);
+          }
+        }
+      }
+      if (candidates_.empty()) break;
+
+      const Move move = candidates_[std::uniform_int_distribution<std::size_t>(
+          0, candidates_.size() - 1)(*rbg)];
+      const int d = offsets_[move.dir];
+      for (int k = 0; k != move.length; ++k) {
+        pos += d;
+        board[pos] = Game::State::kOn;
+      }
+      num_open -= move.length;
+      if (board[pos + d] == Game::State::kOff) {
+        board[pos + d] = Game::State::kBlocked;
+        --num_open;
+        ++path->num_blocks;
+      }
+      path->moves.push_back(move.dir);
+    }
+
+    for (Game::State& state : board) {
+      if (state == Game::State::kOff) {
+        state = Game::State::kBlocked;
+        ++path->num_blocks;
+      }
+    }
+  }
+
+  // Blocks the fields of *game that the path requires, and sets *solution (if
+  // not null) to its winning sequence. On the final layout, the moves of the
+  // path at which there is only one way on are made by the fast action before.
+  void Apply(const Path& path, Game* game, std::vector<int>* solution) const {
+    for (int i : free_) {
+      if (path.board[i] == Game::State::kBlocked) {
+        game->SetBlocked(i % stride_, i / stride_);
+      }
+    }
+    if (solution == nullptr) return;
+
+    solution->assign({path.start % stride_, path.start / stride_});
+    std::vector<Game::State> board = path.board;
+    for (int i : free_) {
+      if (board[i] == Game::State::kOn) board[i] = Game::State::kOff;
+    }
+    int pos = path.start;
+    board[pos] = Game::State::kOn;
+    for (std::size_t k = 0; k != path.moves.size(); ++k) {
+      const int d = offsets_[path.moves[k]];
+      int num_ways = 0;
+      for (int step : offsets_) {
+        num_ways += board[pos + step] == Game::State::kOff;
+      }
+      if (k == 0 || num_ways > 1) solution->push_back(1 << path.moves[k]);
+      while (board[pos + d] == Game::State::kOff) {
+        pos += d;
+        board[pos] = Game::State::kOn;
+      }
+    }
+    solution->push_back(0);
+  }
+
+ private:
+  struct Move {
+    int dir;  // the index into offsets_
+    int length;
+  };
+
+  // Returns the number of fields that a move of the given length (out of run
+  // possible fields) in direction d would cut off from the end of the path,
+  // where num_open fields are "off" before the move. Stopping short costs one
+  // more, for the field that has to be blocked.
+  int Cost(std::vector<Game::State>* board, int num_open, int pos, int d,
+           int length, int run) {
+    const int step = offsets_[d];
+    const int end = pos + step * length;
+    for (int i = pos + step; i != end + step; i += step) {
+      (*board)[i] = Game::State::kOn;
+    }
+    if (length < run) (*board)[end + step] = Game::State::kBlocked;
+
+    // Flood-fills the "off" fields from the end of the move.
+    ++stamp_;
+    stack_.assign(1, end);
+    int num_reached = 0;
+    while (!stack_.empty()) {
+      const int i = stack_.back();
+      stack_.pop_back();
+      for (int offset : offsets_) {
+        const int j = i + offset;
+        if ((*board)[j] == Game::State::kOff && seen_[j] != stamp_) {
+          seen_[j] = stamp_;
+          ++num_reached;
+          stack_.push_back(j);
+        }
+      }
+    }
+
+    if (length < run) (*board)[end + step] = Game::State::kOff;
+    for (int i = pos + step; i != end + step; i += step) {
+      (*board)[i] = Game::State::kOff;
+    }
+    return num_open - length - num_reached;
+  }
+
+  const int stride_;
+  const int offsets_[4];
+  std::vector<Game::State> layout_;
+  std::vector<int> free_;
+
+  std::vector<Move> candidates_;
+  std::vector<unsigned int> seen_;
+  unsigned int stamp_ = 0;
+  std::vector<int> stack_;
+};
+
+}  // namespace
+
+LayoutStats ComputeLayoutStats(const Game& game) {
+  // The winning sequences are replayed on a copy of the layout, which also
+  // leaves out any game in progress.
+  Game copy(game.Height(), game.Width());
+  std::vector<unsigned char> layout(game.LayoutByteSize(8));
+  game.WriteLayoutAsBits(layout.data(), 8);
+  copy.LoadLayoutFromBits(layout.data(), 8);
+  return ComputeLayoutStats(&copy);
+}
+
+LayoutStats ComputeLayoutStats(Game* game) {
+  if (game->HasStarted()) return ComputeLayoutStats(std::as_const(*game));
+
+  LayoutStats stats;
+  auto is_free = [game](int x, int y) {
+    return 1 <= x && x <= game->Width() && 1 <= y && y <= game->Height() &&
+           game->At(x, y) != Game::State::kBlocked;
+  };
+  std::vector<bool> seen((game->Height() + 2) * (game->Width() + 2));
+  std::vector<Game::Coord> stack;
+  int num_dead_ends = 0, num_regions = 0;
+  for (int y = 1; y <= game->Height(); ++y) {
+    for (int x = 1; x <= game->Width(); ++x) {
+      if (!is_free(x, y)) continue;
+      ++stats.num_fields;
+      num_dead_ends += is_free(x, y - 1) + is_free(x, y + 1) +
+                           is_free(x - 1, y) + is_free(x + 1, y) <=
+                       1;
+
+      // Flood-fills each region from its first field.
+      if (seen[x + (game->Width() + 2) * y]) continue;
+      ++num_regions;
+      stack.push_back({x, y});
+      seen[x + (game->Width() + 2) * y] = true;
+      while (!stack.empty()) {
+        const Game::Coord c = stack.back();
+        stack.pop_back();
+        for (Game::Coord d : {Game::Coord{c.x, c.y - 1}, {c.x, c.y + 1},
+                              {c.x - 1, c.y}, {c.x + 1, c.y}}) {
+          if (is_free(d.x, d.y) && !seen[d.x + (game->Width() + 2) * d.y]) {
+            seen[d.x + (game->Width() + 2) * d.y] = true;
+            stack.push_back(d);
+          }
+        }
+      }
+    }
+  }
+  stats.num_defects =
+      std::max(0, num_dead_ends - 2) + std::max(0, num_regions - 1);
+  if (stats.num_defects != 0) return stats;
+
+  SolutionSet solutions;
+  if (!game->IsSolvable(&solutions)) return stats;
+
+  // Replays each winning sequence to measure it.
+  for (const SolutionSet::Solution& solution : solutions) {
+    game->Start(solution.Start().x, solution.Start().y);
+    const int length = solution.size();
+    int branching = 0;
+    for (Game::Dir dir : solution) {
+      const Game::Dir dirs = game->ValidDirs();
+      branching += dirs != Game::kUp && dirs != Game::kDown &&
+                   dirs != Game::kLeft && dirs != Game::kRight;
+      game->MoveFast(dir);
+    }
+    game->Reset();
+
+    ++stats.num_starts;
+    stats.max_length = std::max(stats.max_length, length);
+    stats.max_branching = std::max(stats.max_branching, branching);
+  }
+  return stats;
+}
+
+bool GenerateWithTarget(Game* game, int n, const GenerationTarget& target,
+                        std::mt19937* rbg, int max_steps,
+                        const std::function<bool()>& should_stop) {
+  if (game->HasStarted()) return false;
+
+  // The first n fields are the ones that are blocked in the current candidate.
+  std::vector<Game::Coord> fields;
+  for (int y = 1; y <= game->Height(); ++y) {
+    for (int x = 1; x <= game->Width(); ++x) {
+      if (game->At(x, y) == Game::State::kOff) fields.push_back({x, y});
+    }
+  }
+  const int num_free = fields.size();
+  if (n < 0 || n >= num_free) return false;
+  std::shuffle(fields.begin(), fields.end(), *rbg);
+
+  std::vector<unsigned char> layout(game->LayoutByteSize(8));
+  game->WriteLayoutAsBits(layout.data(), 8);
+
+  // Annealing revisits the same layouts often, so the distance of each layout
+  // is cached, keyed by the packed layout.
+  std::unordered_map<std::string, int> distances;
+  auto distance = [&]() {
+    Game candidate(game->Height(), game->Width());
+    candidate.LoadLayoutFromBits(layout.data(), 8);
+    for (int i = 0; i != n; ++i) candidate.SetBlocked(fields[i].x, fields[i].y);
+    std::string key(candidate.LayoutByteSize(8), '\0');
+    candidate.WriteLayoutAsBits(reinterpret_cast<unsigned char*>(key.data()),
+                                8);
+    auto [it, inserted] = distances.try_emplace(std::move(key), 0);
+    if (inserted) it->second = Distance(ComputeLayoutStats(&candidate), target);
+    return it->second;
+  };
+
+  // The temperature falls geometrically from kHot to kCold over each cycle of
+  // kCycle steps, and then starts over, which lets the search escape from
+  // local minima.
+  constexpr double kHot = 8.0, kCold = 0.25;
+  constexpr int kCycle = 1000;
+  const double cooling = std::pow(kCold / kHot, 1.0 / kCycle);
+  double temperature = kHot;
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  std::uniform_int_distribution<int> pick_blocked(0, std::max(0, n - 1));
+  std::uniform_int_distribution<int> pick_free(n, num_free - 1);
+
+  int current = distance();
+  for (int step = 0; current != 0 && n != 0 && step < max_steps; ++step) {
+    LIGHTGAME_TRACE_SCOPE("GenerateWithTarget step");
+    if (should_stop()) return false;
+
+    const int i = pick_blocked(*rbg), j = pick_free(*rbg);
+    std::swap(fields[i], fields[j]);
+    if (const int next = distance();
+        next <= current ||
+        unit(*rbg) < std::exp((current - next) / temperature)) {
+      current = next;
+    } else {
+      std::swap(fields[i], fields[j]);
+    }
+    temperature = (step + 1) % kCycle == 0 ? kHot : temperature * cooling;
+  }
+  if (current != 0) return false;
+
+  for (int i = 0; i != n; ++i) game->SetBlocked(fields[i].x, fields[i].y);
+  return true;
+}
+
+bool AugmentRandomlyInParallel(Game* game, int n, std::uint64_t seed,
+                               int num_threads, GenerationMode mode,
+                               const std::function<bool()>& should_stop) {
+  if (game->HasStarted()) return false;
+
+  std::vector<Game::Coord> free_fields;
+  for (int y = 1; y <= game->Height(); ++y) {
+    for (int x = 1; x <= game->Width(); ++x) {
+      if (game->At(x, y) == Game::State::kOff) free_fields.push_back({x, y});
+    }
+  }
+  if (n < 0 || n >= static_cast<int>(free_fields.size())) return false;
+
+  if (num_threads <= 0) {
+    num_threads = std::max(1U, std::thread::hardware_concurrency());
+  }
+
+  std::vector<unsigned char> layout(game->LayoutByteSize(8));
+  game->WriteLayoutAsBits(layout.data(), 8);
+
+  constexpr std::uint64_t kNotFound = std::numeric_limits<std::uint64_t>::max();
+  std::atomic<std::uint64_t> next_index{0};
+  std::atomic<std::uint64_t> found_index{kNotFound};
+  std::atomic<bool> done{false};
+  std::atomic<bool> stopped{false};
+
+  // Each worker claims the next candidate index and tests that candidate. In
+  // deterministic mode, a worker only stops once it claims an index beyond a
+  // found solution, since all smaller indices have been claimed by then and
+  // will be tested to completion. So the final result is the smallest index
+  // of any solvable candidate.
+  auto work = [&]() {
+    std::vector<Game::Coord> picked;
+    while (!done) {
+      LIGHTGAME_TRACE_SCOPE("AugmentRandomlyInParallel attempt");
+      const std::uint64_t i = next_index++;
+      if (i > found_index) return;
+      if (should_stop()) {
+        stopped = true;
+        done = true;
+        return;
+      }
+
+      Game candidate(game->Height(), game->Width());
+      candidate.LoadLayoutFromBits(layout.data(), 8);
+      PickFields(free_fields, n, CounterRng(seed, i), &picked);
+      for (const Game::Coord& c : picked) candidate.SetBlocked(c.x, c.y);
+
+      if (candidate.IsSolvable(nullptr)) {
+        std::uint64_t j = found_index;
+        while (i < j && !found_index.compare_exchange_weak(j, i)) {}
+        if (mode == GenerationMode::kRace) done = true;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 1; i < num_threads; ++i) threads.emplace_back(work);
+  work();
+  for (std::thread& t : threads) t.join();
+
+  if (stopped || found_index == kNotFound) return false;
+
+  std::vector<Game::Coord> picked;
+  PickFields(free_fields, n, CounterRng(seed, found_index), &picked);
+  for (const Game::Coord& c : picked) game->SetBlocked(c.x, c.y);
+  return true;
+}
+
+bool GenerateFromPath(Game* game, int min_blocks, int max_blocks,
+                      int max_attempts, std::mt19937* rbg,
+                      std::vector<int>* solution) {
+  if (game->HasStarted()) return false;
+  PathGrower grower(*game);
+  if (!grower.HasFreeFields()) return false;
+
+  PathGrower::Path path;
+  for (int i = 0; i < max_attempts; ++i) {
+    LIGHTGAME_TRACE_SCOPE("GenerateFromPath attempt");
+    grower.Grow(rbg, &path);
+    if (min_blocks <= path.num_blocks && path.num_blocks <= max_blocks) {
+      grower.Apply(path, game, solution);
+      return true;
+    }
+  }
+  return false;
+}
+
+}  //  namespace tkware::lightgame
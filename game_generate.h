@@ -0,0 +1,157 @@
+// Copyright 2019 by Thomas Köppe
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef H_TKWARE_LIGHTGAME_GAME_GENERATE_
+#define H_TKWARE_LIGHTGAME_GAME_GENERATE_
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "game.h"
+
+namespace tkware::lightgame {
+
+// A counter-based random bit generator: the i-th output of the stream (seed,
+// stream) is a fixed function of seed, stream and i, so any number of
+// independent, reproducible streams can be derived from one seed without any
+// shared state. (The outputs are those of SplitMix64.)
+class CounterRng {
+ public:
+  using result_type = std::uint64_t;
+
+  CounterRng(std::uint64_t seed, std::uint64_t stream)
+      : key_(Mix(seed ^ Mix(stream))) {}
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  result_type operator()() { return Mix(key_ + kGamma * ++counter_); }
+
+  // Returns a uniformly distributed value in [0, bound), for positive bound.
+  // Unlike the standard distributions, the result is the same for all
+  // implementations of the standard library.
+  std::uint64_t Below(std::uint64_t bound);
+
+ private:
+  static constexpr std::uint64_t kGamma = 0x9E3779B97F4A7C15;
+
+  static std::uint64_t Mix(std::uint64_t z) {
+    z += kGamma;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+    return z ^ (z >> 31);
+  }
+
+  const std::uint64_t key_;
+  std::uint64_t counter_ = 0;
+};
+
+enum class GenerationMode {
+  // Returns whichever solvable candidate is found first. This has the lowest
+  // latency, but the result depends on the timing of the threads.
+  kRace,
+
+  // Returns the solvable candidate with the lowest index. The result depends
+  // only on the seed, not on the number of threads.
+  kDeterministic,
+};
+
+// Randomly adds n blocked fields to the layout of *game, like
+// Game::AugmentRandomly, but tests candidate layouts on num_threads threads in
+// parallel (or on as many threads as there are cores if num_threads is not
+// positive). The blocked fields of candidate i are drawn from CounterRng(seed,
+// i). Returns false, and leaves the layout unchanged, if a game is in
+// progress, if n is negative or does not leave any field free, or once
+// should_stop returns true; should_stop is polled before each attempt and may
+// be called from several threads at once.
+bool AugmentRandomlyInParallel(
+    Game* game, int n, std::uint64_t seed, int num_threads, GenerationMode mode,
+    const std::function<bool()>& should_stop = [] { return false; });
+
+// Statistics of a layout that targeted generation can aim for, computed from
+// the winning sequences reported by Game::IsSolvable.
+struct LayoutStats {
+  int num_fields = 0;     // the number of fields that are not blocked
+  int num_starts = 0;     // the number of winning starts
+  int max_length = 0;     // the most fast actions in any winning sequence
+  int max_branching = 0;  // the most choices between several directions
+                          // that any winning sequence has to make
+  int num_defects = 0;    // the number of dead ends beyond two, plus the
+                          // number of disconnected regions beyond one; only
+                          // layouts without defects can be solvable
+};
+
+// Computes the statistics of the layout of game, ignoring any game in
+// progress. The winning sequences are replayed on a copy of the layout.
+LayoutStats ComputeLayoutStats(const Game& game);
+
+// As above, but if no game is in progress, the winning sequences are replayed
+// on *game itself, which is left with its layout as before. This avoids the
+// copy when many layouts are measured on one board that is edited in place.
+LayoutStats ComputeLayoutStats(Game* game);
+
+// The desired properties of a generated layout. All ranges are inclusive.
+struct GenerationTarget {
+  int min_starts = 1;
+  int max_starts = 1;
+  bool all_starts = false;  // if set, every field must be a winning start,
+                            // and min_starts and max_starts are ignored
+  int min_length = 0;
+  int max_length = std::numeric_limits<int>::max();
+  int min_branching = 0;
+  int max_branching = std::numeric_limits<int>::max();
+};
+
+// Adds n blocked fields to the layout of *game such that the result meets the
+// target. Rather than drawing independent candidates until one happens to
+// meet the target, this anneals the placement of the n blocks: each step
+// moves one block to a free field, and the move is kept if it brings the
+// layout closer to the target (or, with a probability that decreases over
+// time, even if it does not). Layouts that have been seen before are not
+// solved again. Returns false, and leaves the layout unchanged, if a game is in
+// progress, if n is negative or does not leave any field free, if no matching
+// layout is found within max_steps steps (none if max_steps is not positive,
+// so that only the initial candidate is tried), or once should_stop returns
+// true (which is polled before each step).
+bool GenerateWithTarget(
+    Game* game, int n, const GenerationTarget& target, std::mt19937* rbg,
+    int max_steps,
+    const std::function<bool()>& should_stop = [] { return false; });
+
+// Adds blocked fields to the layout of *game such that the result can be won,
+// by construction rather than by testing candidates: grows a random winning
+// path over the free fields and blocks the fields that the path requires.
+// Each move of the path goes as far as it can, unless every such move would
+// cut free fields off from the path's end, in which case a move may stop
+// short, and the field after its end is blocked. Once the path cannot go on,
+// every free field that it has not covered is blocked. A path takes time
+// proportional to the board area times the number of its moves, and no
+// solver runs. Up to max_attempts paths are grown, and the first one that
+// blocks between min_blocks and max_blocks fields is used. If solution is not
+// null, it is set to the winning sequence of that path, in the format of
+// Game::IsSolvable ("x, y, a_1, ..., a_N, 0"). Returns false, and leaves the
+// layout unchanged, if a game is in progress or if no path blocks a number of
+// fields in the range.
+bool GenerateFromPath(Game* game, int min_blocks, int max_blocks,
+                      int max_attempts, std::mt19937* rbg,
+                      std::vector<int>* solution = nullptr);
+
+}  //  namespace tkware::lightgame
+
+#endif  // H_TKWARE_LIGHTGAME_GAME_GENERATE_
@@ -0,0 +1,267 @@
+#include "game_generate.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "game.h"
+#include "gtest/gtest.h"
+
+namespace tkware::lightgame {
+namespace {
+
+int CountBlocked(const Game& game) {
+  int n = 0;
+  for (int y = 1; y <= game.Height(); ++y) {
+    for (int x = 1; x <= game.Width(); ++x) {
+      n += game.At(x, y) == Game::State::kBlocked;
+    }
+  }
+  return n;
+}
+
+TEST(CounterRng, Reproducible) {
+  CounterRng a(42, 7), b(42, 7), c(42, 8), d(43, 7);
+  for (int i = 0; i != 10; ++i) {
+    const std::uint64_t x = a();
+    EXPECT_EQ(x, b());
+    EXPECT_NE(x, c());
+    EXPECT_NE(x, d());
+  }
+}
+
+TEST(CounterRng, Below) {
+  CounterRng rng(1, 2);
+  std::set<std::uint64_t> seen;
+  for (int i = 0; i != 1000; ++i) {
+    const std::uint64_t x = rng.Below(6);
+    EXPECT_LT(x, 6);
+    seen.insert(x);
+  }
+  EXPECT_EQ(seen.size(), 6);
+}
+
+TEST(AugmentRandomlyInParallel, Race) {
+  Game game(5, 6);
+  ASSERT_TRUE(game.SetBlocked(2, 2));
+  ASSERT_TRUE(AugmentRandomlyInParallel(&game, 5, 1001, 4,
+                                        GenerationMode::kRace));
+  EXPECT_EQ(CountBlocked(game), 6);
+  EXPECT_EQ(game.At(2, 2), Game::State::kBlocked);
+  EXPECT_TRUE(game.IsSolvable(nullptr));
+}
+
+TEST(AugmentRandomlyInParallel, DeterministicAcrossThreadCounts) {
+  for (std::uint64_t seed : {1, 2, 3}) {
+    std::string expected;
+    for (int num_threads : {1, 2, 3, 8}) {
+      Game game(5, 7);
+      ASSERT_TRUE(AugmentRandomlyInParallel(&game, 6, seed, num_threads,
+                                            GenerationMode::kDeterministic));
+      EXPECT_EQ(CountBlocked(game), 6);
+      EXPECT_TRUE(game.IsSolvable(nullptr));
+      if (expected.empty()) expected = SaveToHexString(game);
+      EXPECT_EQ(SaveToHexString(game), expected)
+          << "seed " << seed << ", " << num_threads << " threads";
+    }
+  }
+}
+
+TEST(AugmentRandomlyInParallel, InvalidOperations) {
+  Game game(2, 3);
+  EXPECT_FALSE(AugmentRandomlyInParallel(&game, -1, 1, 2,
+                                         GenerationMode::kRace));
+  EXPECT_FALSE(AugmentRandomlyInParallel(&game, 6, 1, 2,
+                                         GenerationMode::kRace));
+  EXPECT_FALSE(AugmentRandomlyInParallel(&game, 1, 1, 2, GenerationMode::kRace,
+                                         [] { return true; }));
+  EXPECT_EQ(CountBlocked(game), 0);
+
+  EXPECT_TRUE(game.Start(1, 1));
+  EXPECT_FALSE(AugmentRandomlyInParallel(&game, 1, 1, 2,
+                                         GenerationMode::kRace));
+}
+
+TEST(ComputeLayoutStats, OpenGrid) {
+  // From every field, a single fast action covers the 2x3 grid, but there is
+  // a choice of direction first.
+  Game game(2, 3);
+  LayoutStats stats = ComputeLayoutStats(game);
+  EXPECT_EQ(stats.num_fields, 6);
+  EXPECT_EQ(stats.num_starts, 6);
+  EXPECT_EQ(stats.max_length, 1);
+  EXPECT_EQ(stats.max_branching, 1);
+  EXPECT_EQ(stats.num_defects, 0);
+
+  // Two regions with two dead ends each.
+  game.SetBlocked(2, 1);
+  game.SetBlocked(2, 2);
+  stats = ComputeLayoutStats(game);
+  EXPECT_EQ(stats.num_fields, 4);
+  EXPECT_EQ(stats.num_starts, 0);
+  EXPECT_EQ(stats.num_defects, 3);
+}
+
+TEST(ComputeLayoutStats, InPlace) {
+  std::unique_ptr<Game> game = LoadFromHexString("778011A01203040");
+  ASSERT_NE(game, nullptr);
+  const std::string code = SaveToHexString(*game);
+  const LayoutStats expected = ComputeLayoutStats(*game);
+  ASSERT_NE(expected.num_starts, 0);
+
+  const LayoutStats stats = ComputeLayoutStats(game.get());
+  EXPECT_EQ(stats.num_starts, expected.num_starts);
+  EXPECT_EQ(stats.max_length, expected.max_length);
+  EXPECT_EQ(stats.max_branching, expected.max_branching);
+  EXPECT_FALSE(game->HasStarted());
+  EXPECT_EQ(SaveToHexString(*game), code);
+
+  // A game in progress is left alone.
+  for (int i = 0; !game->HasStarted(); ++i) {
+    game->Start(1 + i % game->Width(), 1 + i / game->Width());
+  }
+  const Game::Coord pos = {game->X(), game->Y()};
+  EXPECT_EQ(ComputeLayoutStats(game.get()).num_starts, expected.num_starts);
+  EXPECT_EQ(game->X(), pos.x);
+  EXPECT_EQ(game->Y(), pos.y);
+}
+
+TEST(GenerateWithTarget, UniqueStart) {
+  std::mt19937 rbg(1001);
+  for (int i = 0; i != 5; ++i) {
+    Game game(5, 5);
+    ASSERT_TRUE(game.SetBlocked(1, 1));
+    ASSERT_TRUE(GenerateWithTarget(&game, 3, GenerationTarget(), &rbg, 5000));
+    EXPECT_EQ(CountBlocked(game), 4);
+    EXPECT_EQ(game.At(1, 1), Game::State::kBlocked);
+    EXPECT_EQ(ComputeLayoutStats(game).num_starts, 1);
+  }
+}
+
+TEST(GenerateWithTarget, AllStarts) {
+  std::mt19937 rbg(1001);
+  GenerationTarget target;
+  target.all_starts = true;
+  Game game(3, 4);
+  ASSERT_TRUE(GenerateWithTarget(&game, 2, target, &rbg, 5000));
+  const LayoutStats stats = ComputeLayoutStats(game);
+  EXPECT_EQ(stats.num_fields, 10);
+  EXPECT_EQ(stats.num_starts, 10);
+}
+
+TEST(GenerateWithTarget, DifficultyBand) {
+  std::mt19937 rbg(1001);
+  GenerationTarget target;
+  target.max_starts = 3;
+  target.min_length = 4;
+  target.min_branching = 4;
+  Game game(6, 6);
+  ASSERT_TRUE(GenerateWithTarget(&game, 6, target, &rbg, 50000));
+  const LayoutStats stats = ComputeLayoutStats(game);
+  EXPECT_GE(stats.num_starts, 1);
+  EXPECT_LE(stats.num_starts, 3);
+  EXPECT_GE(stats.max_length, 4);
+  EXPECT_GE(stats.max_branching, 4);
+}
+
+TEST(GenerateWithTarget, InvalidOperations) {
+  std::mt19937 rbg(1001);
+  Game game(2, 3);
+  GenerationTarget impossible;
+  impossible.min_starts = impossible.max_starts = 7;
+  EXPECT_FALSE(GenerateWithTarget(&game, 1, impossible, &rbg, 100));
+  EXPECT_FALSE(GenerateWithTarget(&game, 1, impossible, &rbg, -1));
+  EXPECT_FALSE(GenerateWithTarget(&game, -1, GenerationTarget(), &rbg, 100));
+  EXPECT_FALSE(GenerateWithTarget(&game, 6, GenerationTarget(), &rbg, 100));
+  EXPECT_FALSE(GenerateWithTarget(&game, 1, impossible, &rbg, 100,
+                                  [] { return true; }));
+  EXPECT_EQ(CountBlocked(game), 0);
+
+  EXPECT_TRUE(game.Start(1, 1));
+  EXPECT_FALSE(GenerateWithTarget(&game, 1, GenerationTarget(), &rbg, 100));
+}
+
+// Plays the sequence in the format of Game::IsSolvable, and returns whether it
+// wins the game.
+bool Wins(Game* game, const std::vector<int>& sequence) {
+  if (sequence.size() < 3 || sequence.back() != 0 ||
+      !game->Start(sequence[0], sequence[1])) {
+    return false;
+  }
+  for (std::size_t i = 2; i + 1 < sequence.size(); ++i) {
+    if (!game->MoveFast(Game::Dir(sequence[i]))) return false;
+  }
+  const bool won = game->HaveWon();
+  game->Reset();
+  return won;
+}
+
+constexpr int kAnyNumber = std::numeric_limits<int>::max();
+
+TEST(GenerateFromPath, SolvableByConstruction) {
+  std::mt19937 rbg(1001);
+  for (int i = 0; i != 200; ++i) {
+    Game game(1 + i % 7, 1 + i % 9);
+    std::vector<int> solution;
+    ASSERT_TRUE(GenerateFromPath(&game, 0, kAnyNumber, 1, &rbg, &solution));
+    EXPECT_TRUE(Wins(&game, solution)) << SaveToHexString(game);
+    EXPECT_TRUE(game.IsSolvable(nullptr)) << SaveToHexString(game);
+  }
+}
+
+TEST(GenerateFromPath, KeepsLayout) {
+  std::mt19937 rbg(1001);
+  for (int i = 0; i != 50; ++i) {
+    Game game(6, 6);
+    game.SetBlocked(3, 3);
+    game.SetBlocked(4, 1);
+    std::vector<int> solution;
+    ASSERT_TRUE(GenerateFromPath(&game, 0, kAnyNumber, 1, &rbg, &solution));
+    EXPECT_EQ(game.At(3, 3), Game::State::kBlocked);
+    EXPECT_EQ(game.At(4, 1), Game::State::kBlocked);
+    EXPECT_TRUE(Wins(&game, solution)) << SaveToHexString(game);
+  }
+}
+
+TEST(GenerateFromPath, BlockRange) {
+  std::mt19937 rbg(1001);
+  for (int i = 0; i != 20; ++i) {
+    Game game(6, 6);
+    ASSERT_TRUE(GenerateFromPath(&game, 3, 5, 1000, &rbg));
+    EXPECT_GE(CountBlocked(game), 3);
+    EXPECT_LE(CountBlocked(game), 5);
+    EXPECT_TRUE(game.IsSolvable(nullptr)) << SaveToHexString(game);
+  }
+}
+
+TEST(GenerateFromPath, LargeBoard) {
+  std::mt19937 rbg(1001);
+  Game game(60, 80);
+  std::vector<int> solution;
+  ASSERT_TRUE(GenerateFromPath(&game, 0, kAnyNumber, 1, &rbg, &solution));
+  EXPECT_LT(CountBlocked(game), 60 * 80);
+  EXPECT_TRUE(Wins(&game, solution));
+}
+
+TEST(GenerateFromPath, InvalidOperations) {
+  std::mt19937 rbg(1001);
+  Game game(2, 3);
+  EXPECT_FALSE(GenerateFromPath(&game, 0, kAnyNumber, 0, &rbg));
+  EXPECT_FALSE(GenerateFromPath(&game, 0, kAnyNumber, -1, &rbg));
+  EXPECT_FALSE(GenerateFromPath(&game, 6, kAnyNumber, 100, &rbg));
+  EXPECT_EQ(CountBlocked(game), 0);
+  EXPECT_TRUE(game.Start(1, 1));
+  EXPECT_FALSE(GenerateFromPath(&game, 0, kAnyNumber, 1, &rbg));
+
+  Game blocked(1, 1);
+  blocked.SetBlocked(1, 1);
+  EXPECT_FALSE(GenerateFromPath(&blocked, 0, kAnyNumber, 1, &rbg));
+}
+
+}  // namespace
+}  // namespace tkware::lightgame
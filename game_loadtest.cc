@@ -0,0 +1,330 @@
+// Copyright 2019 by Thomas Köppe
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// A load generator for the engine, to measure throughput and tail latency
+// under a realistic mix of requests before the engine is put behind a service.
+//
+// Usage: game_loadtest [--sessions=N] [--threads=N] [--duration_s=S]
+//                      [--think_min_ms=MS] [--think_max_ms=MS] [--seed=N]
+//
+// Simulates N concurrent player sessions in-process. Each session repeatedly
+// waits for a think time (drawn uniformly from [think_min_ms, think_max_ms])
+// and then makes one request, depending on its state:
+//
+//   load:      loads a level code with LoadFromHexString (or, occasionally,
+//   generate:  generates a new layout with Game::AugmentRandomly instead)
+//   hint:      asks Game::IsSolvable for all solutions, before a game or now
+//              and then during one
+//   start:     starts a game at a random free field
+//   move:      takes a random valid action with Game::Move or Game::MoveFast
+//   reset:     restarts the same layout after a game is over
+//
+// The sessions are divided among the worker threads (one per core by
+// default), and each thread serves its sessions in the order of their wake-up
+// times. At the end, the run reports the operations per second and the
+// latency percentiles of each request type, the lag of the requests behind
+// their scheduled times (which grows once the workers are saturated), and the
+// resident memory per session.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "game.h"
+#include "game_stats.h"
+
+namespace tkware::lightgame {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+enum Op { kLoad, kGenerate, kHint, kStart, kMove, kReset, kNumOps };
+
+constexpr const char* kOpNames[kNumOps] = {"load",  "generate", "hint",
+                                           "start", "move",     "reset"};
+
+struct Session {
+  std::unique_ptr<Game> game;
+  std::mt19937 rbg;
+};
+
+// The level codes that sessions load, made up front.
+std::vector<std::string> MakeCodes(int count, std::mt19937* rbg) {
+  std::vector<std::string> codes;
+  for (int i = 0; i != count; ++i) {
+    const int h = 5 + i % 3, w = 5 + i / 3 % 3;
+    Game game(h, w);
+    game.AugmentRandomly(h * w / 8, rbg, [] { return false; });
+    codes.push_back(SaveToHexString(game));
+  }
+  return codes;
+}
+
+// The resident memory of the process, in bytes.
+std::int64_t ResidentBytes() {
+  std::ifstream status("/proc/self/status");
+  for (std::string line; std::getline(status, line);) {
+    if (line.rfind("VmRSS:", 0) == 0) {
+      std::istringstream iss(line.substr(6));
+      std::int64_t kib = 0;
+      iss >> kib;
+      return kib * 1024;
+    }
+  }
+  return 0;
+}
+
+struct Stats {
+  LatencyHistogram latencies[kNumOps];
+  LatencyHistogram lag;
+
+  void Merge(const Stats& other) {
+    for (int i = 0; i != kNumOps; ++i) latencies[i].Merge(other.latencies[i]);
+    lag.Merge(other.lag);
+  }
+};
+
+class Worker {
+ public:
+  Worker(Session* sessions, std::size_t num_sessions,
+         const std::vector<std::string>& codes, int think_min_ms,
+         int think_max_ms)
+      : sessions_(sessions),
+        num_sessions_(num_sessions),
+        codes_(codes),
+        think_(think_min_ms * 1000, think_max_ms * 1000) {}
+
+  void Run(Clock::time_point start, Clock::time_point end) {
+    // Spreads the first requests over one think time.
+    for (std::size_t i = 0; i != num_sessions_; ++i) {
+      wake_.push({start + Think(&sessions_[i]), i});
+    }
+
+    while (!wake_.empty()) {
+      const auto [when, i] = wake_.top();
+      if (when >= end) break;
+      wake_.pop();
+      std::this_thread::sleep_until(when);
+
+      Session* session = &sessions_[i];
+      const Op op = NextOp(session);
+      const Clock::time_point begin = Clock::now();
+      Serve(op, session);
+      const Clock::time_point done = Clock::now();
+      stats_.latencies[op].Record(done - begin);
+      stats_.lag.Record(begin - when);
+
+      wake_.push({done + Think(session), i});
+    }
+  }
+
+  const Stats& stats() const { return stats_; }
+
+ private:
+  std::chrono::microseconds Think(Session* session) {
+    return std::chrono::microseconds(think_(session->rbg));
+  }
+
+  static bool Chance(Session* session, double p) {
+    return std::bernoulli_distribution(p)(session->rbg);
+  }
+
+  Op NextOp(Session* session) {
+    const Game* game = session->game.get();
+    if (game == nullptr) return Chance(session, 0.02) ? kGenerate : kLoad;
+    if (!game->HasStarted()) return Chance(session, 0.2) ? kHint : kStart;
+    if (game->ValidDirs() != Game::kNone) {
+      return Chance(session, 0.02) ? kHint : kMove;
+    }
+    if (Chance(session, 0.3)) return kReset;
+    return Chance(session, 0.02) ? kGenerate : kLoad;
+  }
+
+  void Serve(Op op, Session* session) {
+    std::unique_ptr<Game>& game = session->game;
+    switch (op) {
+      case kLoad: {
+        std::uniform_int_distribution<std::size_t> pick(0, codes_.size() - 1);
+        game = LoadFromHexString(codes_[pick(session->rbg)]);
+        break;
+      }
+      case kGenerate: {
+        game = std::make_unique<Game>(6, 6);
+        game->AugmentRandomly(4, &session->rbg, [] { return false; });
+        break;
+      }
+      case kHint: {
+        SolutionSet solutions;
+        game->IsSolvable(&solutions);
+        break;
+      }
+      case kStart: {
+        std::uniform_int_distribution<int> x(1, game->Width());
+        std::uniform_int_distribution<int> y(1, game->Height());
+        for (;;) {
+          const int a = x(session->rbg), b = y(session->rbg);
+          if (game->At(a, b) != Game::State::kBlocked) {
+            game->Start(a, b);
+            break;
+          }
+        }
+        break;
+      }
+      case kMove: {
+        Game::Dir dirs[4];
+        int n = 0;
+        const Game::Dir valid = game->ValidDirs();
+        for (Game::Dir dir :
+             {Game::kUp, Game::kDown, Game::kLeft, Game::kRight}) {
+          if (valid & dir) dirs[n++] = dir;
+        }
+        const Game::Dir dir =
+            dirs[std::uniform_int_distribution<int>(0, n - 1)(session->rbg)];
+        if (Chance(session, 0.5)) {
+          game->Move(dir);
+        } else {
+          game->MoveFast(dir);
+        }
+        break;
+      }
+      case kReset:
+        game->Reset();
+        break;
+      case kNumOps:
+        break;
+    }
+  }
+
+  Session* const sessions_;
+  const std::size_t num_sessions_;
+  const std::vector<std::string>& codes_;
+  std::uniform_int_distribution<int> think_;
+
+  using Wake = std::pair<Clock::time_point, std::size_t>;
+  std::priority_queue<Wake, std::vector<Wake>, std::greater<Wake>> wake_;
+  Stats stats_;
+};
+
+bool ParseFlag(const std::string& arg, const std::string& name, int* value) {
+  const std::string prefix = "--" + name + "=";
+  if (arg.rfind(prefix, 0) != 0) return false;
+  std::istringstream iss(arg.substr(prefix.size()));
+  return (iss >> *value) && (iss >> std::ws).eof() && *value >= 0;
+}
+
+void PrintRow(const std::string& name, const LatencyHistogram& h,
+              double seconds) {
+  auto us = [](std::chrono::nanoseconds ns) { return ns.count() / 1000.0; };
+  std::printf("%-10s %10llu %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+              name.c_str(), static_cast<unsigned long long>(h.Count()),
+              h.Count() / seconds, us(h.Percentile(50)), us(h.Percentile(99)),
+              us(h.Percentile(99.9)), us(h.Max()));
+}
+
+int Run(int argc, char* argv[]) {
+  int num_sessions = 1000;
+  int num_threads = std::max(1U, std::thread::hardware_concurrency());
+  int duration_s = 10;
+  int think_min_ms = 10;
+  int think_max_ms = 100;
+  int seed = 1001;
+
+  for (int i = 1; i != argc; ++i) {
+    if (!ParseFlag(argv[i], "sessions", &num_sessions) &&
+        !ParseFlag(argv[i], "threads", &num_threads) &&
+        !ParseFlag(argv[i], "duration_s", &duration_s) &&
+        !ParseFlag(argv[i], "think_min_ms", &think_min_ms) &&
+        !ParseFlag(argv[i], "think_max_ms", &think_max_ms) &&
+        !ParseFlag(argv[i], "seed", &seed)) {
+      std::cerr << "Usage: " << argv[0]
+                << " [--sessions=N] [--threads=N] [--duration_s=S]"
+                   " [--think_min_ms=MS] [--think_max_ms=MS] [--seed=N]\n";
+      return 1;
+    }
+  }
+  num_threads = std::max(1, std::min(num_threads, num_sessions));
+  think_max_ms = std::max(think_min_ms, think_max_ms);
+
+  // The game reports diagnostics on std::cout, which would only slow the
+  // sessions down.
+  std::cout.setstate(std::ios::failbit);
+
+  std::mt19937 rbg(seed);
+  const std::vector<std::string> codes = MakeCodes(64, &rbg);
+
+  const std::int64_t memory_before = ResidentBytes();
+  std::vector<Session> sessions(num_sessions);
+  for (Session& session : sessions) session.rbg.seed(rbg());
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  for (int t = 0; t != num_threads; ++t) {
+    const std::size_t begin = sessions.size() * t / num_threads;
+    const std::size_t end = sessions.size() * (t + 1) / num_threads;
+    workers.push_back(std::make_unique<Worker>(
+        sessions.data() + begin, end - begin, codes, think_min_ms,
+        think_max_ms));
+  }
+
+  const Clock::time_point start = Clock::now();
+  const Clock::time_point end = start + std::chrono::seconds(duration_s);
+  std::vector<std::thread> threads;
+  for (auto& worker : workers) {
+    threads.emplace_back([&worker, start, end] { worker->Run(start, end); });
+  }
+  for (std::thread& thread : threads) thread.join();
+  const double seconds =
+      std::chrono::duration<double>(Clock::now() - start).count();
+  const std::int64_t memory_after = ResidentBytes();
+
+  Stats stats;
+  for (const auto& worker : workers) stats.Merge(worker->stats());
+  LatencyHistogram all;
+  for (const LatencyHistogram& h : stats.latencies) all.Merge(h);
+
+  std::printf("%d sessions on %d threads for %.1f s, think time %d-%d ms\n\n",
+              num_sessions, num_threads, seconds, think_min_ms, think_max_ms);
+  std::printf("%-10s %10s %10s %10s %10s %10s %10s\n", "op", "count",
+              "ops/s", "p50 us", "p99 us", "p999 us", "max us");
+  for (int i = 0; i != kNumOps; ++i) {
+    PrintRow(kOpNames[i], stats.latencies[i], seconds);
+  }
+  PrintRow("all", all, seconds);
+  PrintRow("lag", stats.lag, seconds);
+  std::printf("\nmemory per session: %.1f KiB\n",
+              (memory_after - memory_before) / 1024.0 /
+                  std::max(1, num_sessions));
+  return 0;
+}
+
+}  // namespace
+}  // namespace tkware::lightgame
+
+int main(int argc, char* argv[]) {
+  return tkware::lightgame::Run(argc, argv);
+}
@@ -0,0 +1,332 @@
+// Copyright 2019 by Thomas Köppe
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "game_parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "game.h"
+#include "game_trace.h"
+
+namespace tkware::lightgame {
+namespace {
+
+constexpr Game::Dir kDirs[] = {Game::kUp, Game::kDown, Game::kLeft,
+                               Game::kRight};
+
+// Subtrees deeper than this are never split off, since replaying the actions
+// that lead to them costs more than the parallelism gains.
+constexpr std::size_t kMaxSplitDepth = 16;
+
+// A subtree of the search: its start (an index into the starts), and the
+// actions (indices into kDirs) that lead from the start to its root.
+struct Task {
+  int start;
+  std::vector<unsigned char> actions;
+};
+
+// The tasks of one worker. The owner pushes and pops at the back, so that it
+// works depth-first; other workers steal from the front, where the subtrees
+// nearest to the root (i.e. the largest ones) are.
+class TaskDeque {
+ public:
+  void Push(Task task) {
+    std::lock_guard<std::mutex> lock(mu_);
+    tasks_.push_back(std::move(task));
+  }
+
+  bool Pop(Task* task) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (tasks_.empty()) return false;
+    *task = std::move(tasks_.back());
+    tasks_.pop_back();
+    return true;
+  }
+
+  bool Steal(Task* task) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (tasks_.empty()) return false;
+    *task = std::move(tasks_.front());
+    tasks_.pop_front();
+    return true;
+  }
+
+ private:
+  std::mutex mu_;
+  std::deque<Task> tasks_;
+};
+
+class ParallelSolver {
+ public:
+  ParallelSolver(const Game& game, std::vector<Game::Coord> starts,
+                 int num_threads, bool all_starts);
+
+  bool Run(std::vector<int>* solutions);
+
+ private:
+  class Worker;
+
+  // Pushes a task onto the deque of worker w.
+  void Push(int w, Task task) {
+    ++pending_;
+    ++queued_;
+    deques_[w]->Push(std::move(task));
+  }
+
+  // Takes a task from the deque of worker w, at the back if w is the caller
+  // and at the front otherwise.
+  bool Pop(int w, Task* task) {
+    if (!deques_[w]->Pop(task)) return false;
+    --queued_;
+    return true;
+  }
+  bool Steal(int w, Task* task) {
+    if (!deques_[w]->Steal(task)) return false;
+    --queued_;
+    return true;
+  }
+
+  bool Cancelled(int start) const {
+    return solved_[start].load(std::memory_order_relaxed) ||
+           (!all_starts_ && any_solved_.load(std::memory_order_relaxed));
+  }
+
+  void Report(int start, std::vector<int> solution);
+
+  const int stride_;
+  const std::vector<Game::Coord> starts_;
+  const int num_threads_;
+  const bool all_starts_;
+  const PaddedBoard layout_;
+
+  std::vector<std::unique_ptr<TaskDeque>> deques_;
+  std::atomic<int> pending_{0};  // tasks that have not finished
+  std::atomic<int> queued_{0};   // tasks that no worker has taken yet
+  std::atomic<int> idle_{0};     // workers that are looking for a task
+  std::unique_ptr<std::atomic<bool>[]> solved_;
+  std::atomic<bool> any_solved_{false};
+
+  std::mutex results_mu_;
+  std::vector<std::vector<int>> results_;
+};
+
+// A worker owns a copy of the board and searches one task at a time, like
+// Game::IsSolvable (on a PaddedBoard, with the same pruning).
+class ParallelSolver::Worker {
+ public:
+  Worker(ParallelSolver* solver, int id)
+      : solver_(solver), id_(id), board_(solver->layout_) {}
+
+  void Run() {
+    bool idle = false;
+    for (Task task;;) {
+      if (solver_->Pop(id_, &task) || Steal(&task)) {
+        if (idle) {
+          --solver_->idle_;
+          idle = false;
+        }
+        Search(task);
+        --solver_->pending_;
+      } else if (solver_->pending_ == 0) {
+        break;
+      } else {
+        if (!idle) {
+          ++solver_->idle_;
+          idle = true;
+        }
+        std::this_thread::yield();
+      }
+    }
+    if (idle) --solver_->idle_;
+  }
+
+ private:
+  struct Frame {
+    int pos;
+    unsigned int children;  // the directions that are yet to be tried
+    std::size_t trail;      // the length of the trail before the action
+    int dir;                // the action, or -1 at the root of the task
+  };
+
+  bool Steal(Task* task) {
+    for (int k = 1; k != solver_->num_threads_; ++k) {
+      if (solver_->Steal((id_ + k) % solver_->num_threads_, task)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Returns the actions from the start to the root of the subtree of the
+  // given direction at frame k.
+  std::vector<unsigned char> Actions(const Task& task, std::size_t k,
+                                     int dir) const {
+    std::vector<unsigned char> actions = task.actions;
+    for (std::size_t i = 1; i <= k; ++i) actions.push_back(frames_[i].dir);
+    actions.push_back(dir);
+    return actions;
+  }
+
+  // Hands the untried subtrees of the shallowest frame that has any to the
+  // other workers, keeping one if it is the current frame.
+  void Split(const Task& task) {
+    const std::size_t top = frames_.size() - 1;
+    for (std::size_t k = 0;
+         k <= top && task.actions.size() + k < kMaxSplitDepth; ++k) {
+      unsigned int& children = frames_[k].children;
+      unsigned int split = k == top ? children & (children - 1) : children;
+      if (split == 0) continue;
+      children &= ~split;
+      for (; split != 0; split &= split - 1) {
+        solver_->Push(id_, {task.start, Actions(task, k, __builtin_ctz(split))});
+      }
+      return;
+    }
+  }
+
+  void Search(const Task& task) {
+    LIGHTGAME_TRACE_SCOPE("IsSolvableInParallel task");
+    if (solver_->Cancelled(task.start)) return;
+
+    const Game::Coord start = solver_->starts_[task.start];
+    int pos = start.x + solver_->stride_ * start.y;
+    board_.Start(pos);
+    for (unsigned char a : task.actions) pos = board_.MoveFast(pos, a);
+
+    frames_.clear();
+    frames_.push_back(Frame{pos, board_.Children(pos), board_.TrailSize(), -1});
+    for (unsigned int n = 0; !frames_.empty(); ++n) {
+      if (n % 64 == 0 && solver_->Cancelled(task.start)) break;
+
+      if (frames_.back().children != 0 &&
+          solver_->queued_.load(std::memory_order_relaxed) <
+              solver_->idle_.load(std::memory_order_relaxed)) {
+        Split(task);
+      }
+
+      Frame& frame = frames_.back();
+      if (frame.children != 0) {
+        const int d = __builtin_ctz(frame.children);
+        frame.children &= frame.children - 1;
+        const std::size_t length = board_.TrailSize();
+        const int next = board_.MoveFast(frame.pos, d);
+        frames_.push_back(Frame{next, board_.Children(next), length, d});
+      } else if (board_.NumOff() == 0) {
+        std::vector<int> solution = {start.x, start.y};
+        for (unsigned char a : task.actions) solution.push_back(kDirs[a]);
+        for (std::size_t i = 1; i != frames_.size(); ++i) {
+          solution.push_back(kDirs[frames_[i].dir]);
+        }
+        solution.push_back(0);
+        solver_->Report(task.start, std::move(solution));
+        break;
+      } else {
+        board_.Undo(frame.trail);
+        frames_.pop_back();
+      }
+    }
+    board_.Undo(0);
+  }
+
+  ParallelSolver* const solver_;
+  const int id_;
+  PaddedBoard board_;
+  std::vector<Frame> frames_;
+};
+
+ParallelSolver::ParallelSolver(const Game& game,
+                               std::vector<Game::Coord> starts,
+                               int num_threads, bool all_starts)
+    : stride_(game.Width() + 2),
+      starts_(std::move(starts)),
+      num_threads_(num_threads),
+      all_starts_(all_starts),
+      layout_(game),
+      solved_(std::make_unique<std::atomic<bool>[]>(starts_.size())),
+      results_(starts_.size()) {
+  for (int i = 0; i != num_threads_; ++i) {
+    deques_.push_back(std::make_unique<TaskDeque>());
+  }
+}
+
+void ParallelSolver::Report(int start, std::vector<int> solution) {
+  std::lock_guard<std::mutex> lock(results_mu_);
+  if (solved_[start]) return;
+  results_[start] = std::move(solution);
+  solved_[start] = true;
+  any_solved_ = true;
+}
+
+bool ParallelSolver::Run(std::vector<int>* solutions) {
+  // The starts are dealt out in reverse, so that each worker takes its
+  // starts in order.
+  for (int i = starts_.size() - 1; i >= 0; --i) {
+    const int x = starts_[i].x, y = starts_[i].y;
+    if (layout_.IsOff(x + stride_ * y)) Push(i % num_threads_, {i, {}});
+  }
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  for (int i = 0; i != num_threads_; ++i) {
+    workers.push_back(std::make_unique<Worker>(this, i));
+  }
+  std::vector<std::thread> threads;
+  for (int i = 1; i < num_threads_; ++i) {
+    threads.emplace_back(&Worker::Run, workers[i].get());
+  }
+  workers[0]->Run();
+  for (std::thread& t : threads) t.join();
+
+  if (solutions != nullptr) {
+    for (const std::vector<int>& solution : results_) {
+      solutions->insert(solutions->end(), solution.begin(), solution.end());
+    }
+  }
+  return any_solved_;
+}
+
+int NumThreads(int num_threads) {
+  return num_threads > 0
+             ? num_threads
+             : static_cast<int>(std::max(1U, std::thread::hardware_concurrency()));
+}
+
+}  // namespace
+
+bool IsSolvableInParallel(const Game& game, int num_threads,
+                          std::vector<int>* solutions) {
+  std::vector<Game::Coord> starts;
+  for (int y = 1; y <= game.Height(); ++y) {
+    for (int x = 1; x <= game.Width(); ++x) starts.push_back({x, y});
+  }
+  return ParallelSolver(game, std::move(starts), NumThreads(num_threads),
+                        solutions != nullptr)
+      .Run(solutions);
+}
+
+bool SolveStartInParallel(const Game& game, int x, int y, int num_threads,
+                          std::vector<int>* solution) {
+  if (x < 1 || x > game.Width() || y < 1 || y > game.Height()) return false;
+  return ParallelSolver(game, {{x, y}}, NumThreads(num_threads), false)
+      .Run(solution);
+}
+
+}  //  namespace tkware::lightgame
@@ -0,0 +1,45 @@
+// Copyright 2019 by Thomas Köppe
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef H_TKWARE_LIGHTGAME_GAME_PARALLEL_
+#define H_TKWARE_LIGHTGAME_GAME_PARALLEL_
+
+#include <vector>
+
+#include "game.h"
+
+namespace tkware::lightgame {
+
+// Like Game::IsSolvable for the layout of game (ignoring any game in
+// progress), but the search trees of all starts are explored by num_threads
+// threads together (or by as many threads as there are cores if num_threads
+// is not positive). Whenever a thread is idle, the open subtrees nearest to
+// the root of a busy thread's search are split off as tasks, which idle
+// threads steal, so that even a single start with a large tree is searched by
+// all threads. Once a solution is found for a start, the rest of the search
+// of that start (or of all starts, if solutions is null) is abandoned.
+//
+// The solutions are appended in the order of their starts, as by
+// Game::IsSolvable, but the solution of each start is whichever was found
+// first, so it may differ from that of Game::IsSolvable and between runs.
+bool IsSolvableInParallel(const Game& game, int num_threads,
+                          std::vector<int>* solutions = nullptr);
+
+// As above, but only for the start x, y.
+bool SolveStartInParallel(const Game& game, int x, int y, int num_threads,
+                          std::vector<int>* solution = nullptr);
+
+}  //  namespace tkware::lightgame
+
+#endif  // H_TKWARE_LIGHTGAME_GAME_PARALLEL_
@@ -0,0 +1,114 @@
+#include "game_parallel.h"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "game.h"
+#include "game_verify.h"
+#include "gtest/gtest.h"
+
+namespace tkware::lightgame {
+namespace {
+
+// Returns the starts of the solutions, in order.
+std::vector<Game::Coord> Starts(const std::vector<int>& solutions) {
+  SolutionSet set;
+  EXPECT_TRUE(set.AppendFromLegacy(solutions));
+  std::vector<Game::Coord> starts;
+  for (const SolutionSet::Solution& solution : set) {
+    starts.push_back(solution.Start());
+  }
+  return starts;
+}
+
+void ExpectSameAsGame(Game* game, int num_threads) {
+  std::vector<int> expected, actual;
+  ASSERT_EQ(IsSolvableInParallel(*game, num_threads, &actual),
+            game->IsSolvable(&expected))
+      << SaveToHexString(*game);
+  EXPECT_EQ(Starts(actual), Starts(expected)) << SaveToHexString(*game);
+
+  SolutionVerifier verifier(*game);
+  std::vector<VerifyResult> results(100);
+  const std::size_t n = verifier.VerifyAll(
+      actual.data(), actual.data() + actual.size(), results.data(),
+      results.size());
+  for (std::size_t i = 0; i != n; ++i) {
+    EXPECT_EQ(results[i].verdict, Verdict::kWin) << SaveToHexString(*game);
+  }
+
+  EXPECT_EQ(IsSolvableInParallel(*game, num_threads), !expected.empty());
+}
+
+TEST(IsSolvableInParallel, GoodGames) {
+  for (const char* code : {"6902400412202000", "75040208103",
+                           "778011A01203040", "77180C100202500",
+                           "780821248002200C", "8700204008058000"}) {
+    std::unique_ptr<Game> game = LoadFromHexString(code);
+    ASSERT_NE(game, nullptr);
+    for (int num_threads : {1, 2, 4}) ExpectSameAsGame(game.get(), num_threads);
+  }
+}
+
+TEST(IsSolvableInParallel, RandomLayouts) {
+  std::mt19937 rbg(1001);
+  for (int i = 0; i != 100; ++i) {
+    Game game(5, 6);
+    for (int k = 0; k != 4; ++k) game.SetBlocked(1 + rbg() % 6, 1 + rbg() % 5);
+    ExpectSameAsGame(&game, 3);
+  }
+}
+
+TEST(IsSolvableInParallel, IgnoresGameInProgress) {
+  Game game(2, 3);
+  ASSERT_TRUE(game.Start(2, 1));
+  ASSERT_TRUE(game.Move(Game::kDown));
+  std::vector<int> solutions;
+  EXPECT_TRUE(IsSolvableInParallel(game, 2, &solutions));
+  EXPECT_EQ(Starts(solutions).size(), 6);
+}
+
+TEST(SolveStartInParallel, LargeBoard) {
+  Game game(7, 9);
+  game.SetBlocked(3, 3);
+  std::vector<int> expected;
+  ASSERT_TRUE(game.IsSolvable(&expected));
+  const Game::Coord start = Starts(expected).back();
+
+  std::vector<int> solution;
+  ASSERT_TRUE(SolveStartInParallel(game, start.x, start.y, 4, &solution));
+  ASSERT_EQ(Starts(solution).size(), 1);
+  EXPECT_EQ(Starts(solution)[0], start);
+  EXPECT_EQ(SolutionVerifier(game).Verify(solution.data(),
+                                          solution.data() + solution.size() - 1)
+                .verdict,
+            Verdict::kWin);
+}
+
+TEST(SolveStartInParallel, EachStart) {
+  Game game(2, 3);
+  game.SetBlocked(3, 2);
+  std::vector<int> expected;
+  ASSERT_TRUE(game.IsSolvable(&expected));
+  const std::vector<Game::Coord> starts = Starts(expected);
+  for (int y = 1; y <= 2; ++y) {
+    for (int x = 1; x <= 3; ++x) {
+      const bool wins =
+          std::find(starts.begin(), starts.end(), Game::Coord{x, y}) !=
+          starts.end();
+      EXPECT_EQ(SolveStartInParallel(game, x, y, 2), wins) << x << ", " << y;
+    }
+  }
+
+  std::vector<int> solution;
+  EXPECT_FALSE(SolveStartInParallel(game, 0, 1, 2, &solution));
+  EXPECT_FALSE(SolveStartInParallel(game, 1, 3, 2, &solution));
+  EXPECT_TRUE(solution.empty());
+  EXPECT_TRUE(SolveStartInParallel(game, 3, 1, 0, &solution));
+  EXPECT_EQ(solution, (std::vector<int>{3, 1, Game::kLeft, 0}));
+}
+
+}  // namespace
+}  // namespace tkware::lightgame
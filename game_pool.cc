@@ -0,0 +1,195 @@
+// Copyright 2019 by Thomas Köppe
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "game_pool.h"
+
+#ifdef __linux__
+#include <sys/resource.h>
+#endif
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include "game.h"
+#include "game_trace.h"
+
+namespace tkware::lightgame {
+
+PuzzlePool::PuzzlePool(std::string path, std::size_t capacity, int num_threads,
+                       std::size_t max_keys)
+    : path_(std::move(path)), capacity_(capacity), max_keys_(max_keys) {
+  if (!path_.empty()) Load(path_);
+  for (int i = 0; i != num_threads; ++i) {
+    threads_.emplace_back([this] { Refill(); });
+  }
+}
+
+PuzzlePool::~PuzzlePool() {
+  {
+    std::lock_guard lock(mutex_);
+    stopping_ = true;
+  }
+  cv_.notify_all();
+  for (std::thread& t : threads_) t.join();
+  if (!path_.empty()) Save(path_);
+}
+
+bool PuzzlePool::IsValid(const Key& key) {
+  return key.height >= 1 && key.width >= 1 && 0 <= key.min_blocks &&
+         key.min_blocks <= key.max_blocks &&
+         key.max_blocks < key.height * key.width;
+}
+
+std::unique_ptr<Game> PuzzlePool::Generate(
+    const Key& key, std::mt19937* rbg,
+    const std::function<bool()>& should_stop) {
+  LIGHTGAME_TRACE_SCOPE("PuzzlePool::Generate");
+  auto game = std::make_unique<Game>(key.height, key.width);
+  int n = std::uniform_int_distribution(key.min_blocks, key.max_blocks)(*rbg);
+  if (!game->AugmentRandomly(n, rbg, should_stop)) return nullptr;
+  return game;
+}
+
+std::unique_ptr<Game> PuzzlePool::Take(const Key& key, std::mt19937* rbg) {
+  if (!IsValid(key)) return nullptr;
+
+  {
+    // This also registers the key for refilling.
+    std::lock_guard lock(mutex_);
+    auto [it, inserted] = slots_.try_emplace(key);
+    Slot& slot = it->second;
+    slot.last_take = ++tick_;
+    if (inserted) EvictLocked();
+    if (!slot.games.empty()) {
+      std::unique_ptr<Game> game = std::move(slot.games.front());
+      slot.games.pop_front();
+      cv_.notify_all();
+      return game;
+    }
+  }
+  cv_.notify_all();
+  return Generate(key, rbg, [] { return false; });
+}
+
+std::size_t PuzzlePool::Size(const Key& key) const {
+  std::lock_guard lock(mutex_);
+  auto it = slots_.find(key);
+  return it == slots_.end() ? 0 : it->second.games.size();
+}
+
+void PuzzlePool::EvictLocked() {
+  while (slots_.size() > max_keys_) {
+    auto victim = slots_.end();
+    for (auto it = slots_.begin(); it != slots_.end(); ++it) {
+      if (it->second.pending == 0 &&
+          (victim == slots_.end() ||
+           it->second.last_take < victim->second.last_take)) {
+        victim = it;
+      }
+    }
+    if (victim == slots_.end()) return;
+    slots_.erase(victim);
+  }
+}
+
+void PuzzlePool::Refill() {
+#ifdef __linux__
+  // On Linux, this only lowers the priority of the calling thread.
+  setpriority(PRIO_PROCESS, 0, 19);
+#endif
+
+  std::mt19937 rbg(std::random_device{}());
+  auto should_stop = [this] { return stopping_.load(); };
+
+  std::unique_lock lock(mutex_);
+  for (;;) {
+    Key key;
+    Slot* slot = nullptr;
+    // Picks the slot that was refilled longest ago among those that need
+    // layouts, so that the slots take turns.
+    cv_.wait(lock, [&] {
+      if (stopping_) return true;
+      for (auto& [k, s] : slots_) {
+        if (s.games.size() + s.pending < capacity_ &&
+            (slot == nullptr || s.last_fill < slot->last_fill)) {
+          key = k;
+          slot = &s;
+        }
+      }
+      return slot != nullptr;
+    });
+    if (stopping_) return;
+
+    slot->last_fill = ++tick_;
+    ++slot->pending;
+    lock.unlock();
+    std::unique_ptr<Game> game = Generate(key, &rbg, should_stop);
+    lock.lock();
+    --slot->pending;
+    if (game != nullptr) slot->games.push_back(std::move(game));
+  }
+}
+
+bool PuzzlePool::Load(const std::string& path) {
+  std::ifstream in(path);
+  if (!in) return false;
+
+  std::lock_guard lock(mutex_);
+  for (std::string line; std::getline(in, line);) {
+    std::istringstream iss(line);
+    Key key;
+    std::string code;
+    if (!(iss >> key.height >> key.width >> key.min_blocks >> key.max_blocks >>
+          code) ||
+        !IsValid(key)) {
+      continue;
+    }
+    std::unique_ptr<Game> game = LoadFromHexString(code);
+    if (game == nullptr || game->Height() != key.height ||
+        game->Width() != key.width) {
+      continue;
+    }
+    slots_[key].games.push_back(std::move(game));
+  }
+  EvictLocked();
+  cv_.notify_all();
+  return !in.bad();
+}
+
+bool PuzzlePool::Save(const std::string& path) const {
+  // Write to a temporary file first, so that an interrupted save does not
+  // destroy the previous pool.
+  const std::string tmp_path = path + ".tmp";
+  {
+    std::ofstream out(tmp_path);
+    std::lock_guard lock(mutex_);
+    for (const auto& [key, slot] : slots_) {
+      if (key.height >= 16 || key.width >= 16) continue;
+      for (const std::unique_ptr<Game>& game : slot.games) {
+        out << key.height << ' ' << key.width << ' ' << key.min_blocks << ' '
+            << key.max_blocks << ' ' << SaveToHexString(*game) << '\n';
+      }
+    }
+    if (!out.flush()) return false;
+  }
+  return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+}  //  namespace tkware::lightgame
@@ -0,0 +1,129 @@
+// Copyright 2019 by Thomas Köppe
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef H_TKWARE_LIGHTGAME_GAME_POOL_
+#define H_TKWARE_LIGHTGAME_GAME_POOL_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "game.h"
+
+namespace tkware::lightgame {
+
+// A pool of pre-generated, solvable random layouts, so that requests for a
+// random layout can usually be served instantly rather than by running the
+// (potentially slow) random generation on demand.
+//
+// Layouts are pooled per key, i.e. per board size and range of blocked fields.
+// Every key that has been requested or loaded is kept topped up to the given
+// capacity by low-priority background threads, which generate layouts with
+// Game::AugmentRandomly; the threads take turns between the keys that need
+// layouts, so that no key is starved by another. At most max_keys keys are
+// kept: when a new key is requested, the layouts of the least recently
+// requested key are dropped. Optionally, the pool is loaded from a file on
+// construction and saved back to it on destruction, so that even the first
+// request after a restart can be served from the pool.
+class PuzzlePool {
+ public:
+  struct Key {
+    int height, width;
+    int min_blocks, max_blocks;
+
+    friend bool operator==(const Key& lhs, const Key& rhs) {
+      return lhs.height == rhs.height && lhs.width == rhs.width &&
+             lhs.min_blocks == rhs.min_blocks &&
+             lhs.max_blocks == rhs.max_blocks;
+    }
+  };
+
+  // Starts num_threads background threads. If path is not empty, the pool is
+  // loaded from and saved to the file at path (which need not exist yet).
+  explicit PuzzlePool(std::string path = {}, std::size_t capacity = 8,
+                      int num_threads = 1, std::size_t max_keys = 16);
+
+  // Stops the background threads and saves the pool, if requested.
+  ~PuzzlePool();
+
+  PuzzlePool(const PuzzlePool&) = delete;
+  PuzzlePool& operator=(const PuzzlePool&) = delete;
+
+  // Returns a random, solvable layout for the given key: one from the pool if
+  // possible (in constant time), otherwise a newly generated one. Returns null
+  // if the key is invalid, i.e. if the board is empty, the block range is
+  // empty or negative, or it does not leave at least one free field.
+  std::unique_ptr<Game> Take(const Key& key, std::mt19937* rbg);
+
+  // Returns the number of layouts currently pooled for the given key.
+  std::size_t Size(const Key& key) const;
+
+  // Loads pooled layouts from the file at path, and saves them to it. The file
+  // format is line-based text; each line contains height, width, min_blocks,
+  // max_blocks and the level code, separated by spaces. Only layouts that can
+  // be represented by a level code are saved. Both return false on I/O error.
+  bool Load(const std::string& path);
+  bool Save(const std::string& path) const;
+
+ private:
+  struct KeyHash {
+    std::size_t operator()(const Key& key) const {
+      return std::hash<int>()(((key.height * 31 + key.width) * 31 +
+                               key.min_blocks) * 31 + key.max_blocks);
+    }
+  };
+
+  struct Slot {
+    std::deque<std::unique_ptr<Game>> games;
+    std::size_t pending = 0;      // number of layouts being generated
+    std::uint64_t last_take = 0;  // tick of the last Take, 0 if none
+    std::uint64_t last_fill = 0;  // tick of the last refill, 0 if none
+  };
+
+  static bool IsValid(const Key& key);
+  static std::unique_ptr<Game> Generate(const Key& key, std::mt19937* rbg,
+                                        const std::function<bool()>& should_stop);
+
+  void Refill();
+
+  // Drops least recently requested slots until at most max_keys_ remain.
+  // Slots whose layouts are being generated are kept. Requires mutex_.
+  void EvictLocked();
+
+  const std::string path_;
+  const std::size_t capacity_;
+  const std::size_t max_keys_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::unordered_map<Key, Slot, KeyHash> slots_;
+  std::uint64_t tick_ = 0;
+  std::atomic<bool> stopping_{false};
+
+  std::vector<std::thread> threads_;
+};
+
+}  //  namespace tkware::lightgame
+
+#endif  // H_TKWARE_LIGHTGAME_GAME_POOL_
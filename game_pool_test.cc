@@ -0,0 +1,107 @@
+#include "game_pool.h"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+
+#include "game.h"
+#include "gtest/gtest.h"
+
+namespace tkware::lightgame {
+namespace {
+
+int CountBlocked(const Game& game) {
+  int n = 0;
+  for (int y = 1; y <= game.Height(); ++y) {
+    for (int x = 1; x <= game.Width(); ++x) {
+      n += game.At(x, y) == Game::State::kBlocked;
+    }
+  }
+  return n;
+}
+
+// Waits (for a while) until the pool has n layouts for the key.
+bool WaitForSize(const PuzzlePool& pool, const PuzzlePool::Key& key,
+                 std::size_t n) {
+  for (int i = 0; i != 1000 && pool.Size(key) < n; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return pool.Size(key) >= n;
+}
+
+TEST(PuzzlePool, TakeAndRefill) {
+  std::mt19937 rbg(1001);
+  PuzzlePool pool({}, 4, 2);
+  const PuzzlePool::Key key = {4, 5, 2, 3};
+  EXPECT_EQ(pool.Size(key), 0);
+
+  // The first request is served synchronously.
+  std::unique_ptr<Game> game = pool.Take(key, &rbg);
+  ASSERT_TRUE(game != nullptr);
+  EXPECT_EQ(game->Height(), 4);
+  EXPECT_EQ(game->Width(), 5);
+  EXPECT_TRUE(game->IsSolvable(nullptr));
+  EXPECT_GE(CountBlocked(*game), 2);
+  EXPECT_LE(CountBlocked(*game), 3);
+
+  // Afterwards, the background threads fill the pool up to its capacity.
+  ASSERT_TRUE(WaitForSize(pool, key, 4));
+  game = pool.Take(key, &rbg);
+  ASSERT_TRUE(game != nullptr);
+  EXPECT_TRUE(game->IsSolvable(nullptr));
+  EXPECT_LE(pool.Size(key), 4);
+}
+
+TEST(PuzzlePool, KeyLimit) {
+  std::mt19937 rbg(1001);
+  PuzzlePool pool({}, 1, 1, 2);
+  const PuzzlePool::Key a = {3, 3, 1, 1}, b = {3, 4, 1, 1}, c = {4, 4, 1, 1};
+  ASSERT_TRUE(pool.Take(a, &rbg) != nullptr);
+  ASSERT_TRUE(pool.Take(b, &rbg) != nullptr);
+  ASSERT_TRUE(WaitForSize(pool, a, 1));
+  ASSERT_TRUE(WaitForSize(pool, b, 1));
+
+  // Requesting a third key drops the least recently requested one.
+  ASSERT_TRUE(pool.Take(a, &rbg) != nullptr);
+  ASSERT_TRUE(pool.Take(c, &rbg) != nullptr);
+  ASSERT_TRUE(WaitForSize(pool, a, 1));
+  ASSERT_TRUE(WaitForSize(pool, c, 1));
+  EXPECT_EQ(pool.Size(b), 0);
+}
+
+TEST(PuzzlePool, InvalidKeys) {
+  std::mt19937 rbg(1001);
+  PuzzlePool pool({}, 1, 0);
+  EXPECT_EQ(pool.Take({0, 5, 1, 2}, &rbg), nullptr);
+  EXPECT_EQ(pool.Take({3, 3, 2, 1}, &rbg), nullptr);
+  EXPECT_EQ(pool.Take({3, 3, -1, 1}, &rbg), nullptr);
+  EXPECT_EQ(pool.Take({3, 3, 1, 9}, &rbg), nullptr);
+}
+
+TEST(PuzzlePool, Persistence) {
+  const std::string path = testing::TempDir() + "/game_pool_test.txt";
+  std::remove(path.c_str());
+  const PuzzlePool::Key key = {3, 4, 1, 2};
+
+  {
+    std::mt19937 rbg(1001);
+    PuzzlePool pool(path, 3, 1);
+    ASSERT_TRUE(pool.Take(key, &rbg) != nullptr);
+    ASSERT_TRUE(WaitForSize(pool, key, 3));
+  }
+
+  // No background threads, so anything in the pool was loaded from the file.
+  PuzzlePool pool(path, 3, 0);
+  EXPECT_EQ(pool.Size(key), 3);
+  std::mt19937 rbg(1001);
+  std::unique_ptr<Game> game = pool.Take(key, &rbg);
+  ASSERT_TRUE(game != nullptr);
+  EXPECT_TRUE(game->IsSolvable(nullptr));
+  EXPECT_EQ(pool.Size(key), 2);
+}
+
+}  // namespace
+}  // namespace tkware::lightgame
@@ -12,15 +12,28 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <string>
+
 #include <QtCore/QCoreApplication>
+#include <QtCore/QStringList>
 #include <QtWidgets/QApplication>
 
+#include "game_trace.h"
 #include "game_window.h"
 
 int main(int argc, char* argv[]) {
+  tkware::lightgame::StartTracingFromEnv();
   QApplication app(argc, argv);
   QCoreApplication::setApplicationName("Corner Paint");
-  tkware::lightgame::MainWindow mainwin;
+
+  // Usage: game_qt [--pool=PATH] [--record=PATH], see MainWindow.
+  std::string pool_path, record_path;
+  for (const QString& arg : QCoreApplication::arguments()) {
+    if (arg.startsWith("--pool=")) pool_path = arg.mid(7).toStdString();
+    if (arg.startsWith("--record=")) record_path = arg.mid(9).toStdString();
+  }
+
+  tkware::lightgame::MainWindow mainwin(nullptr, pool_path, record_path);
   mainwin.show();
   return app.exec();
 }
@@ -0,0 +1,324 @@
+// Copyright 2019 by Thomas Köppe
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "game_reference.h"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "game.h"
+
+namespace tkware::lightgame {
+namespace {
+
+constexpr Game::Dir kAllDirs[] = {Game::kUp, Game::kDown, Game::kLeft,
+                                  Game::kRight};
+
+// The reference board: a copy of the layout with a border of blocked fields,
+// in row-major order. Nothing here should ever be optimised.
+class Board {
+ public:
+  explicit Board(const Game& game)
+      : stride_(game.Width() + 2),
+        cells_((game.Height() + 2) * stride_, Game::State::kBlocked) {
+    for (int y = 1; y <= game.Height(); ++y) {
+      for (int x = 1; x <= game.Width(); ++x) {
+        if (game.At(x, y) != Game::State::kBlocked) {
+          cells_[Index(x, y)] = Game::State::kOff;
+        }
+      }
+    }
+  }
+
+  int Index(int x, int y) const { return x + stride_ * y; }
+
+  bool IsOff(int i) const { return cells_[i] == Game::State::kOff; }
+
+  void SwitchOn(int i) { cells_[i] = Game::State::kOn; }
+  void SwitchOff(int i) { cells_[i] = Game::State::kOff; }
+
+  bool HaveWon() const {
+    return std::find(cells_.begin(), cells_.end(), Game::State::kOff) ==
+           cells_.end();
+  }
+
+  int Step(Game::Dir dir) const {
+    switch (dir) {
+      case Game::kUp:
+        return -stride_;
+      case Game::kDown:
+        return +stride_;
+      case Game::kLeft:
+        return -1;
+      default:
+        return +1;
+    }
+  }
+
+  Game::Dir ValidDirs(int pos) const {
+    Game::Dir dirs = Game::kNone;
+    for (Game::Dir dir : kAllDirs) {
+      if (IsOff(pos + Step(dir))) dirs |= dir;
+    }
+    return dirs;
+  }
+
+  // Moves from pos in direction dir, and keeps going for as long as there is a
+  // unique valid direction. Appends the fields that were switched on to
+  // *changed and returns the final position.
+  int MoveFast(int pos, Game::Dir dir, std::vector<int>* changed) {
+    for (;;) {
+      while (IsOff(pos + Step(dir))) {
+        pos += Step(dir);
+        SwitchOn(pos);
+        changed->push_back(pos);
+      }
+      switch (Game::Dir d = ValidDirs(pos)) {
+        case Game::kUp:
+        case Game::kDown:
+        case Game::kLeft:
+        case Game::kRight:
+          dir = d;
+          break;
+        default:
+          return pos;
+      }
+    }
+  }
+
+ private:
+  const int stride_;
+  std::vector<Game::State> cells_;
+};
+
+bool Search(Board* board, int pos, std::vector<int>* actions) {
+  const Game::Dir dirs = board->ValidDirs(pos);
+  if (dirs == Game::kNone) return board->HaveWon();
+
+  for (Game::Dir dir : kAllDirs) {
+    if ((dirs & dir) != dir) continue;
+    std::vector<int> changed;
+    const int next = board->MoveFast(pos, dir, &changed);
+    actions->push_back(dir);
+    if (Search(board, next, actions)) return true;
+    actions->pop_back();
+    for (int i : changed) board->SwitchOff(i);
+  }
+  return false;
+}
+
+// Splits solutions in the format of Game::IsSolvable into the individual
+// sequences (without the terminating zeros). Returns false if the input is
+// malformed.
+bool SplitSolutions(const std::vector<int>& solutions,
+                    std::vector<std::vector<int>>* sequences) {
+  for (auto it = solutions.begin(); it != solutions.end(); ++it) {
+    if (solutions.end() - it < 3) return false;
+    auto zero = std::find(it + 2, solutions.end(), 0);
+    if (zero == solutions.end()) return false;
+    sequences->emplace_back(it, zero);
+    it = zero;
+  }
+  return true;
+}
+
+// The complete state of a game, for detecting modifications.
+std::vector<int> Snapshot(const Game& game) {
+  std::vector<int> snapshot = {game.X(), game.Y()};
+  for (int y = 1; y <= game.Height(); ++y) {
+    for (int x = 1; x <= game.Width(); ++x) {
+      snapshot.push_back(static_cast<int>(game.At(x, y)));
+    }
+  }
+  return snapshot;
+}
+
+// Returns a copy of the layout of the game without row skip_y and column
+// skip_x (if positive), and with the field unblock unblocked (if on the board).
+std::unique_ptr<Game> Derive(const Game& game, int skip_y, int skip_x,
+                             Game::Coord unblock) {
+  auto result = std::make_unique<Game>(game.Height() - (skip_y > 0),
+                                       game.Width() - (skip_x > 0));
+  for (int y = 1, ry = 1; y <= game.Height(); ++y) {
+    if (y == skip_y) continue;
+    for (int x = 1, rx = 1; x <= game.Width(); ++x) {
+      if (x == skip_x) continue;
+      if (game.At(x, y) == Game::State::kBlocked &&
+          !(unblock == Game::Coord{x, y})) {
+        result->SetBlocked(rx, ry);
+      }
+      ++rx;
+    }
+    ++ry;
+  }
+  return result;
+}
+
+}  // namespace
+
+bool ReferenceIsSolvable(const Game& game, std::vector<int>* solutions) {
+  bool solvable = false;
+  for (int y = 1; y <= game.Height(); ++y) {
+    for (int x = 1; x <= game.Width(); ++x) {
+      if (game.At(x, y) == Game::State::kBlocked) continue;
+
+      Board board(game);
+      board.SwitchOn(board.Index(x, y));
+      std::vector<int> actions;
+      if (!Search(&board, board.Index(x, y), &actions)) continue;
+
+      solvable = true;
+      if (solutions == nullptr) return true;
+      solutions->push_back(x);
+      solutions->push_back(y);
+      solutions->insert(solutions->end(), actions.begin(), actions.end());
+      solutions->push_back(0);
+    }
+  }
+  return solvable;
+}
+
+bool IsWinningSequence(const Game& game, const std::vector<int>& sequence) {
+  if (sequence.size() < 2) return false;
+  const int x = sequence[0], y = sequence[1];
+  if (x < 1 || x > game.Width() || y < 1 || y > game.Height() ||
+      game.At(x, y) == Game::State::kBlocked) {
+    return false;
+  }
+
+  Board board(game);
+  int pos = board.Index(x, y);
+  board.SwitchOn(pos);
+  std::vector<int> changed;
+  for (auto it = sequence.begin() + 2; it != sequence.end(); ++it) {
+    const Game::Dir dir = Game::Dir(*it);
+    if (std::find(std::begin(kAllDirs), std::end(kAllDirs), dir) ==
+            std::end(kAllDirs) ||
+        (board.ValidDirs(pos) & dir) != dir) {
+      return false;
+    }
+    pos = board.MoveFast(pos, dir, &changed);
+  }
+  return board.ValidDirs(pos) == Game::kNone && board.HaveWon();
+}
+
+std::unique_ptr<Game> RandomLayout(int height, int width, double density,
+                                   std::mt19937* rbg) {
+  auto game = std::make_unique<Game>(height, width);
+  std::bernoulli_distribution blocked(density);
+  for (int y = 1; y <= height; ++y) {
+    for (int x = 1; x <= width; ++x) {
+      if (blocked(*rbg)) game->SetBlocked(x, y);
+    }
+  }
+  return game;
+}
+
+std::string CompareWithReference(Game* game, const SolverEngine& engine,
+                                 bool exact_witnesses) {
+  std::ostringstream os;
+  const std::vector<int> snapshot = Snapshot(*game);
+
+  std::vector<int> expected;
+  const bool expected_solvable = ReferenceIsSolvable(*game, &expected);
+
+  std::vector<int> actual;
+  const bool actual_solvable = engine(game, &actual);
+  if (Snapshot(*game) != snapshot) return "engine modified the game";
+  const bool quick_solvable = engine(game, nullptr);
+  if (Snapshot(*game) != snapshot) return "engine modified the game";
+
+  if (actual_solvable != expected_solvable ||
+      quick_solvable != expected_solvable) {
+    os << "solvability: engine says " << actual_solvable << " (and "
+       << quick_solvable << " without solutions), reference says "
+       << expected_solvable;
+    return os.str();
+  }
+
+  std::vector<std::vector<int>> expected_sequences, actual_sequences;
+  SplitSolutions(expected, &expected_sequences);
+  if (!SplitSolutions(actual, &actual_sequences)) {
+    return "engine reported malformed solutions";
+  }
+  if (actual_solvable != !actual_sequences.empty()) {
+    return "engine result does not match its solutions";
+  }
+
+  auto starts = [](const std::vector<std::vector<int>>& sequences) {
+    std::vector<std::pair<int, int>> result;
+    for (const auto& s : sequences) result.emplace_back(s[0], s[1]);
+    std::sort(result.begin(), result.end());
+    return result;
+  };
+  if (starts(actual_sequences) != starts(expected_sequences)) {
+    os << "winning starts differ: engine reports " << actual_sequences.size()
+       << ", reference " << expected_sequences.size();
+    return os.str();
+  }
+
+  for (const auto& sequence : actual_sequences) {
+    if (!IsWinningSequence(*game, sequence)) {
+      os << "sequence from (" << sequence[0] << ", " << sequence[1]
+         << ") does not win";
+      return os.str();
+    }
+  }
+
+  if (exact_witnesses && actual != expected) {
+    return "winning sequences differ from those of the reference";
+  }
+  return {};
+}
+
+std::unique_ptr<Game> ShrinkLayout(const Game& game,
+                                   const std::function<bool(Game*)>& fails) {
+  std::unique_ptr<Game> current = Derive(game, 0, 0, {0, 0});
+
+  // Tries all single reductions of the current layout in turn, and restarts
+  // from the first one that still fails.
+  for (bool progress = true; progress;) {
+    progress = false;
+    std::vector<std::unique_ptr<Game>> candidates;
+    for (int y = 1; current->Height() > 1 && y <= current->Height(); ++y) {
+      candidates.push_back(Derive(*current, y, 0, {0, 0}));
+    }
+    for (int x = 1; current->Width() > 1 && x <= current->Width(); ++x) {
+      candidates.push_back(Derive(*current, 0, x, {0, 0}));
+    }
+    for (int y = 1; y <= current->Height(); ++y) {
+      for (int x = 1; x <= current->Width(); ++x) {
+        if (current->At(x, y) == Game::State::kBlocked) {
+          candidates.push_back(Derive(*current, 0, 0, {x, y}));
+        }
+      }
+    }
+    for (std::unique_ptr<Game>& candidate : candidates) {
+      if (fails(candidate.get())) {
+        current = std::move(candidate);
+        progress = true;
+        break;
+      }
+    }
+  }
+  return current;
+}
+
+}  //  namespace tkware::lightgame
@@ -0,0 +1,69 @@
+// Copyright 2019 by Thomas Köppe
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef H_TKWARE_LIGHTGAME_GAME_REFERENCE_
+#define H_TKWARE_LIGHTGAME_GAME_REFERENCE_
+
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "game.h"
+
+namespace tkware::lightgame {
+
+// Tools for differential testing of solver engines against a reference.
+
+// A solver engine with the interface of Game::IsSolvable.
+using SolverEngine = std::function<bool(Game*, std::vector<int>*)>;
+
+// The reference solver: a deliberately straightforward depth-first search that
+// only uses the public layout of the game, and that is kept frozen so that
+// optimised engines can be validated against it. It has the semantics of
+// Game::IsSolvable, and reports, for each winning start (in row-major order),
+// the first winning sequence of fast actions when trying directions in the
+// order up, down, left, right.
+bool ReferenceIsSolvable(const Game& game, std::vector<int>* solutions);
+
+// Returns whether the sequence "x, y, a_1, a_2, ..., a_N" of fast actions wins
+// the layout of the game (ignoring its current state if it is in progress).
+bool IsWinningSequence(const Game& game, const std::vector<int>& sequence);
+
+// Returns a layout of the given size in which each field is blocked with the
+// given probability.
+std::unique_ptr<Game> RandomLayout(int height, int width, double density,
+                                   std::mt19937* rbg);
+
+// Runs the engine on the layout of *game, both with and without solutions,
+// and compares the results with those of the reference solver. Returns an
+// empty string if they agree, and a description of the first difference
+// otherwise. The engine must agree on solvability and on the set of winning
+// starts, every sequence it reports must be winning, and it must leave the
+// game as it was. If exact_witnesses is true, the reported sequences must also
+// be exactly those of the reference solver.
+std::string CompareWithReference(Game* game, const SolverEngine& engine,
+                                 bool exact_witnesses);
+
+// Shrinks a layout for which fails returns true to a smaller one that still
+// fails: repeatedly removes rows and columns and unblocks fields for as long
+// as the layout keeps failing. The result is minimal in the sense that no
+// single further removal or unblocking fails.
+std::unique_ptr<Game> ShrinkLayout(const Game& game,
+                                   const std::function<bool(Game*)>& fails);
+
+}  //  namespace tkware::lightgame
+
+#endif  // H_TKWARE_LIGHTGAME_GAME_REFERENCE_
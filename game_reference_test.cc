@@ -0,0 +1,134 @@
+#include "game_reference.h"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "game.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace tkware::lightgame {
+namespace {
+
+using ::testing::ElementsAre;
+
+bool GameIsSolvable(Game* game, std::vector<int>* solutions) {
+  return game->IsSolvable(solutions);
+}
+
+TEST(Reference, KnownLayouts) {
+  // A 2x3 grid without blocked fields is solvable from every field.
+  Game open(2, 3);
+  std::vector<int> solutions;
+  EXPECT_TRUE(ReferenceIsSolvable(open, &solutions));
+  EXPECT_EQ(std::count(solutions.begin(), solutions.end(), 0), 6);
+  EXPECT_THAT(std::vector<int>(solutions.begin(), solutions.begin() + 4),
+              ElementsAre(1, 1, Game::kDown, 0));
+
+  // Two parts that are not connected can never both be covered.
+  Game split(2, 5);
+  split.SetBlocked(3, 1);
+  split.SetBlocked(3, 2);
+  EXPECT_FALSE(ReferenceIsSolvable(split, nullptr));
+
+  // A cross has three dead ends too many.
+  Game cross(3, 3);
+  cross.SetBlocked(1, 1);
+  cross.SetBlocked(3, 1);
+  cross.SetBlocked(1, 3);
+  cross.SetBlocked(3, 3);
+  EXPECT_FALSE(ReferenceIsSolvable(cross, nullptr));
+}
+
+TEST(Reference, WinningSequences) {
+  Game game(2, 3);
+  EXPECT_TRUE(IsWinningSequence(game, {1, 1, Game::kDown}));
+  EXPECT_TRUE(IsWinningSequence(game, {1, 1, Game::kRight}));
+  EXPECT_FALSE(IsWinningSequence(game, {1, 1}));
+  EXPECT_FALSE(IsWinningSequence(game, {1, 1, Game::kUp}));
+  EXPECT_FALSE(IsWinningSequence(game, {1, 1, Game::kDown, Game::kDown}));
+  EXPECT_FALSE(IsWinningSequence(game, {1, 1, Game::kDown | Game::kRight}));
+  EXPECT_FALSE(IsWinningSequence(game, {0, 1, Game::kDown}));
+  EXPECT_FALSE(IsWinningSequence(game, {1, 3, Game::kUp}));
+
+  // The state of a game in progress is ignored.
+  ASSERT_TRUE(game.Start(2, 1));
+  EXPECT_TRUE(IsWinningSequence(game, {1, 1, Game::kDown}));
+}
+
+TEST(Reference, GameAgreesWithReference) {
+  std::mt19937 rbg(1001);
+  for (int i = 0; i != 400; ++i) {
+    const int h = 1 + i % 6, w = 1 + (i / 6) % 7;
+    const double density = 0.05 * (i % 7);
+    std::unique_ptr<Game> game = RandomLayout(h, w, density, &rbg);
+    const std::string code = SaveToHexString(*game);
+    EXPECT_EQ(CompareWithReference(game.get(), GameIsSolvable, true), "")
+        << "Layout: " << code;
+  }
+}
+
+TEST(Reference, DetectsAndShrinksMismatches) {
+  // An engine that is wrong on all layouts that are at least three wide.
+  SolverEngine broken = [](Game* game, std::vector<int>* solutions) {
+    const bool solvable = game->IsSolvable(solutions);
+    return game->Width() >= 3 ? !solvable : solvable;
+  };
+  auto fails = [&](Game* game) {
+    return !CompareWithReference(game, broken, false).empty();
+  };
+
+  std::mt19937 rbg(1001);
+  std::unique_ptr<Game> game = RandomLayout(5, 6, 0.2, &rbg);
+  ASSERT_TRUE(fails(game.get()));
+  EXPECT_FALSE(fails(RandomLayout(5, 2, 0.2, &rbg).get()));
+
+  std::unique_ptr<Game> shrunk = ShrinkLayout(*game, fails);
+  EXPECT_EQ(SaveToHexString(*shrunk), "130");
+}
+
+TEST(Reference, DetectsModifications) {
+  SolverEngine meddling = [](Game* game, std::vector<int>* solutions) {
+    game->Start(1, 1);
+    return game->IsSolvable(solutions);
+  };
+  Game game(2, 2);
+  EXPECT_EQ(CompareWithReference(&game, meddling, false),
+            "engine modified the game");
+}
+
+TEST(LevelCode, RoundTrip) {
+  std::mt19937 rbg(1001);
+  for (int h = 1; h <= 15; ++h) {
+    for (int w = 1; w <= 15; ++w) {
+      std::unique_ptr<Game> game = RandomLayout(h, w, 0.3, &rbg);
+      const std::string code = SaveToHexString(*game);
+      std::unique_ptr<Game> loaded = LoadFromHexString(code);
+      ASSERT_TRUE(loaded != nullptr) << code;
+      ASSERT_EQ(loaded->Height(), h);
+      ASSERT_EQ(loaded->Width(), w);
+      for (int y = 1; y <= h; ++y) {
+        for (int x = 1; x <= w; ++x) {
+          EXPECT_EQ(loaded->At(x, y), game->At(x, y)) << code;
+        }
+      }
+      EXPECT_EQ(SaveToHexString(*loaded), code);
+    }
+  }
+}
+
+TEST(LevelCode, RejectsBadCodes) {
+  EXPECT_EQ(LoadFromHexString(""), nullptr);
+  EXPECT_EQ(LoadFromHexString("2"), nullptr);
+  EXPECT_EQ(LoadFromHexString("230"), nullptr);
+  EXPECT_EQ(LoadFromHexString("23000"), nullptr);
+  EXPECT_EQ(LoadFromHexString("230G"), nullptr);
+  EXPECT_EQ(LoadFromHexString("G300"), nullptr);
+  EXPECT_NE(LoadFromHexString("2300"), nullptr);
+}
+
+}  // namespace
+}  // namespace tkware::lightgame
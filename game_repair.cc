@@ -0,0 +1,249 @@
+// Copyright 2019 by Thomas Köppe
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "game_repair.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "game.h"
+#include "game_analysis.h"
+#include "game_trace.h"
+
+namespace tkware::lightgame {
+namespace {
+
+// Tries the edit sets of one size at a time. Fields are numbered in row-major
+// order from 0, and the candidate layout is kept both in free_ (with a border
+// of blocked padding) and in scratch_, for the solvers.
+class Repairer {
+ public:
+  Repairer(const Game& game, int min_starts,
+           const std::function<bool()>& should_stop)
+      : height_(game.Height()),
+        width_(game.Width()),
+        stride_(game.Width() + 2),
+        min_starts_(min_starts),
+        should_stop_(should_stop),
+        free_((height_ + 2) * stride_, 0),
+        scratch_(height_, width_) {
+    for (int i = 0; i != NumFields(); ++i) {
+      const Game::Coord c = CoordOf(i);
+      if (game.At(c.x, c.y) == Game::State::kBlocked) {
+        scratch_.At(c.x, c.y) = Game::State::kBlocked;
+      } else {
+        free_[Pos(i)] = 1;
+        ++num_free_;
+        balance_ += Colour(i);
+      }
+    }
+  }
+
+  bool Run(int max_edits, std::vector<LayoutEdit>* edits) {
+    for (int n = 0; n <= std::min(max_edits, NumFields()) && !stopped_; ++n) {
+      if (Search(0, n)) {
+        edits->clear();
+        for (int i : chosen_) edits->push_back({CoordOf(i), !free_[Pos(i)]});
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  int NumFields() const { return height_ * width_; }
+  Game::Coord CoordOf(int i) const { return {i % width_ + 1, i / width_ + 1}; }
+  int Pos(int i) const { return i % width_ + 1 + stride_ * (i / width_ + 1); }
+
+  // Fields are coloured like a chessboard, +1 and -1.
+  int Colour(int i) const { return (i % width_ + i / width_) % 2 ? -1 : +1; }
+
+  int FreeNeighbours(int pos) const {
+    return free_[pos - stride_] + free_[pos + stride_] + free_[pos - 1] +
+           free_[pos + 1];
+  }
+
+  void Toggle(int i) {
+    const int pos = Pos(i);
+    free_[pos] ^= 1;
+    num_free_ += free_[pos] ? 1 : -1;
+    balance_ += free_[pos] ? Colour(i) : -Colour(i);
+    const Game::Coord c = CoordOf(i);
+    scratch_.At(c.x, c.y) =
+        free_[pos] ? Game::State::kOff : Game::State::kBlocked;
+  }
+
+  // Tries all sets of num_edits edits of fields from field `from` onwards, on
+  // top of the current candidate layout.
+  bool Search(int from, int num_edits) {
+    if (num_edits == 0) {
+      if (should_stop_()) {
+        stopped_ = true;
+        return false;
+      }
+      return MeetsTarget();
+    }
+    if (!MayMeetTarget(from, num_edits)) return false;
+    for (int i = from; i + num_edits <= NumFields() && !stopped_; ++i) {
+      Toggle(i);
+      chosen_.push_back(i);
+      if (Search(i + 1, num_edits - 1)) return true;
+      chosen_.pop_back();
+      Toggle(i);
+    }
+    return false;
+  }
+
+  // Returns false if no num_edits further edits of fields from field `from`
+  // onwards can leave a layout that can be won.
+  //
+  // A winning path alternates between the colours, so the numbers of free
+  // fields of either colour differ by at most one, and each edit changes the
+  // difference by one.
+  //
+  // An edit only changes whether the edited field and its neighbours are dead
+  // ends, so each edit removes at most five dead ends, and if the fields that
+  // could remove some dead ends are disjoint from those that could remove
+  // others, each of those dead ends but two needs an edit of its own.
+  bool MayMeetTarget(int from, int num_edits) {
+    if (std::abs(balance_) - 1 > num_edits) return false;
+
+    // With at most one field left, dead ends do not matter.
+    if (num_free_ - num_edits <= 1) return true;
+    int num_dead_ends = 0, num_separate = 0;
+    taken_.assign(NumFields(), 0);
+    for (int i = 0; i != NumFields(); ++i) {
+      const int pos = Pos(i);
+      if (!free_[pos] || FreeNeighbours(pos) > 1) continue;
+      ++num_dead_ends;
+
+      int fixers[5], num_fixers = 0;
+      for (int j : {i - width_, i - 1, i, i + 1, i + width_}) {
+        if (j >= from && j < NumFields() && IsNeighbour(i, j)) {
+          fixers[num_fixers++] = j;
+        }
+      }
+      if (std::none_of(fixers, fixers + num_fixers,
+                       [this](int j) { return taken_[j]; })) {
+        ++num_separate;
+        for (int k = 0; k != num_fixers; ++k) taken_[fixers[k]] = 1;
+      }
+    }
+    return num_separate <= num_edits + 2 && num_dead_ends - 2 <= 5 * num_edits;
+  }
+
+  // Whether field j is field i or one of its neighbours (given that it is
+  // one of i ± 1, i ± width_).
+  bool IsNeighbour(int i, int j) const {
+    return i / width_ == j / width_ || i % width_ == j % width_;
+  }
+
+  bool MeetsTarget() {
+    if (num_free_ <= 1) return num_free_ == 1 && min_starts_ == 1;
+    if (std::abs(balance_) > 1) return false;
+
+    std::vector<int> dead_ends;
+    for (int i = 0; i != NumFields(); ++i) {
+      const int pos = Pos(i);
+      if (free_[pos] && FreeNeighbours(pos) <= 1) {
+        if (dead_ends.size() == 2) return false;
+        dead_ends.push_back(i);
+      }
+    }
+    if (!IsConnected()) return false;
+
+    if (std::uint16_t starts; scratch_.LookUpSolvableStarts(&starts)) {
+      return __builtin_popcount(starts) >= min_starts_;
+    }
+
+    // The path must begin on one dead end and end on the other, if there are
+    // two, and if one colour has more free fields, it begins and ends on that
+    // colour.
+    int num_starts = 0;
+    for (int i = 0;
+         i != NumFields() && num_starts < min_starts_ && !stopped_; ++i) {
+      if (free_[Pos(i)] && Colour(i) * balance_ >= 0 &&
+          (dead_ends.size() != 2 ||
+           std::find(dead_ends.begin(), dead_ends.end(), i) !=
+               dead_ends.end()) &&
+          WinsFrom(CoordOf(i))) {
+        ++num_starts;
+      }
+    }
+    return num_starts >= min_starts_;
+  }
+
+  bool IsConnected() {
+    int first = 0;
+    while (!free_[Pos(first)]) ++first;
+    seen_.assign(free_.size(), 0);
+    stack_.assign(1, Pos(first));
+    seen_[Pos(first)] = 1;
+    int num_reached = 0;
+    while (!stack_.empty()) {
+      const int pos = stack_.back();
+      stack_.pop_back();
+      ++num_reached;
+      for (int next : {pos - stride_, pos + stride_, pos - 1, pos + 1}) {
+        if (free_[next] && !seen_[next]) {
+          seen_[next] = 1;
+          stack_.push_back(next);
+        }
+      }
+    }
+    return num_reached == num_free_;
+  }
+
+  bool WinsFrom(Game::Coord start) {
+    scratch_.Start(start.x, start.y);
+    const LiveAnalysis analysis = analyzer_.Analyze(scratch_, -1, should_stop_);
+    scratch_.Reset();
+    if (!analysis.known) stopped_ = true;
+    return analysis.winnable;
+  }
+
+  const int height_;
+  const int width_;
+  const int stride_;
+  const int min_starts_;
+  const std::function<bool()>& should_stop_;
+
+  std::vector<unsigned char> free_;
+  int num_free_ = 0;
+  int balance_ = 0;  // the sum of the colours of the free fields
+  Game scratch_;
+  LiveAnalyzer analyzer_;
+
+  std::vector<int> chosen_;
+  bool stopped_ = false;
+
+  std::vector<unsigned char> taken_;
+  std::vector<unsigned char> seen_;
+  std::vector<int> stack_;
+};
+
+}  // namespace
+
+bool RepairLayout(const Game& game, int max_edits, int min_starts,
+                  std::vector<LayoutEdit>* edits,
+                  const std::function<bool()>& should_stop) {
+  LIGHTGAME_TRACE_SCOPE("RepairLayout");
+  return Repairer(game, std::max(min_starts, 1), should_stop)
+      .Run(max_edits, edits);
+}
+
+}  //  namespace tkware::lightgame
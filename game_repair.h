@@ -0,0 +1,62 @@
+// Copyright 2019 by Thomas Köppe
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef H_TKWARE_LIGHTGAME_GAME_REPAIR_
+#define H_TKWARE_LIGHTGAME_GAME_REPAIR_
+
+#include <functional>
+#include <vector>
+
+#include "game.h"
+
+namespace tkware::lightgame {
+
+// A change of one field of a layout.
+struct LayoutEdit {
+  Game::Coord pos;
+  bool block;  // whether the field becomes blocked (rather than free)
+
+  friend bool operator==(const LayoutEdit& lhs, const LayoutEdit& rhs) {
+    return lhs.pos == rhs.pos && lhs.block == rhs.block;
+  }
+};
+
+// Finds a smallest set of at most max_edits edits that makes the layout of
+// game (ignoring any game in progress) winnable from at least min_starts
+// start fields. The edit sets are tried in order of size, and among sets of
+// the same size in row-major order, and the first one that works is stored in
+// *edits; it is empty if the layout already meets the target.
+//
+// A winning path visits the fields of either colour of a chessboard
+// alternately, and it has to begin or end on every dead end (a free field with
+// at most one free neighbour). So a layout can only be won if the numbers of
+// free fields of the two colours differ by at most one, if it has at most two
+// dead ends, and if its free fields are connected. The search keeps the
+// candidate layout in place, one edit at a time, and it abandons a partial
+// set of edits as soon as the remaining edits cannot meet the first two
+// conditions. The remaining candidates are solved only as far as needed: by
+// table lookup on small boards, and otherwise from those starts that the
+// conditions allow (e.g. only from the dead ends if there are two), until
+// min_starts winning starts have been found.
+//
+// Returns false if no such edits exist, or once should_stop returns true
+// (which is polled before each candidate, and while a candidate is solved).
+bool RepairLayout(
+    const Game& game, int max_edits, int min_starts,
+    std::vector<LayoutEdit>* edits,
+    const std::function<bool()>& should_stop = [] { return false; });
+
+}  //  namespace tkware::lightgame
+
+#endif  // H_TKWARE_LIGHTGAME_GAME_REPAIR_
@@ -0,0 +1,138 @@
+#include "game_repair.h"
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "game.h"
+#include "gtest/gtest.h"
+
+namespace tkware::lightgame {
+namespace {
+
+std::unique_ptr<Game> FromMask(int height, int width, unsigned int mask) {
+  auto game = std::make_unique<Game>(height, width);
+  for (int i = 0; i != height * width; ++i) {
+    if ((mask >> i) & 1) game->SetBlocked(i % width + 1, i / width + 1);
+  }
+  return game;
+}
+
+int NumStarts(const Game& game) {
+  SolutionSet solutions;
+  game.IsSolvable(&solutions);
+  return solutions.size();
+}
+
+std::unique_ptr<Game> Apply(const Game& game,
+                            const std::vector<LayoutEdit>& edits) {
+  auto result = LoadFromHexString(SaveToHexString(game));
+  for (const LayoutEdit& edit : edits) {
+    EXPECT_NE(result->At(edit.pos.x, edit.pos.y) == Game::State::kBlocked,
+              edit.block);
+    result->At(edit.pos.x, edit.pos.y) =
+        edit.block ? Game::State::kBlocked : Game::State::kOff;
+  }
+  return result;
+}
+
+// The fewest edits, up to max_edits, after which the layout can be won from
+// at least min_starts starts, by trying all layouts; or -1.
+int MinEdits(int height, int width, unsigned int mask, int max_edits,
+             int min_starts) {
+  int best = -1;
+  for (unsigned int other = 0; other != 1U << (height * width); ++other) {
+    const int n = __builtin_popcount(mask ^ other);
+    if (n > max_edits || (best != -1 && n >= best)) continue;
+    if (NumStarts(*FromMask(height, width, other)) >= min_starts) best = n;
+  }
+  return best;
+}
+
+TEST(RepairLayout, AlreadySolvable) {
+  Game game(2, 3);
+  std::vector<LayoutEdit> edits = {{{1, 1}, true}};
+  EXPECT_TRUE(RepairLayout(game, 3, 1, &edits));
+  EXPECT_TRUE(edits.empty());
+}
+
+TEST(RepairLayout, SmallestEdits) {
+  // +--+--+--+
+  // |  |##|  |
+  // +--+--+--+
+  //
+  // Blocking either end leaves a single field, which is won trivially, but
+  // only unblocking the middle gives two starts.
+  std::unique_ptr<Game> game = FromMask(1, 3, 0b010);
+  std::vector<LayoutEdit> edits;
+  ASSERT_TRUE(RepairLayout(*game, 3, 1, &edits));
+  EXPECT_EQ(edits, (std::vector<LayoutEdit>{{{1, 1}, true}}));
+  ASSERT_TRUE(RepairLayout(*game, 3, 2, &edits));
+  EXPECT_EQ(edits, (std::vector<LayoutEdit>{{{2, 1}, false}}));
+  EXPECT_FALSE(RepairLayout(*game, 3, 3, &edits));
+  EXPECT_FALSE(RepairLayout(*game, 0, 1, &edits));
+}
+
+TEST(RepairLayout, AllSmallLayouts) {
+  for (auto [h, w] : {std::pair{2, 2}, {3, 3}, {2, 4}}) {
+    for (unsigned int mask = 0; mask != 1U << (h * w); ++mask) {
+      for (int min_starts : {1, 2, 4}) {
+        std::unique_ptr<Game> game = FromMask(h, w, mask);
+        std::vector<LayoutEdit> edits;
+        const int expected = MinEdits(h, w, mask, 3, min_starts);
+        ASSERT_EQ(RepairLayout(*game, 3, min_starts, &edits), expected != -1)
+            << SaveToHexString(*game) << ", " << min_starts;
+        if (expected == -1) continue;
+        ASSERT_EQ(edits.size(), expected) << SaveToHexString(*game);
+        EXPECT_GE(NumStarts(*Apply(*game, edits)), min_starts);
+      }
+    }
+  }
+}
+
+TEST(RepairLayout, LargerLayouts) {
+  std::mt19937 rbg(1001);
+  int num_repaired = 0;
+  for (int i = 0; i != 20; ++i) {
+    Game game(5, 5);
+    for (int k = 0; k != 4; ++k) game.SetBlocked(rbg() % 5 + 1, rbg() % 5 + 1);
+
+    std::vector<LayoutEdit> edits;
+    const bool repaired = RepairLayout(game, 2, 1, &edits);
+    num_repaired += repaired;
+    if (repaired) {
+      EXPECT_GE(NumStarts(*Apply(game, edits)), 1) << SaveToHexString(game);
+    }
+
+    // No single edit (or none at all) would have done.
+    if (!repaired || edits.size() == 2) {
+      EXPECT_EQ(NumStarts(game), 0);
+      for (int f = 0; f != 25; ++f) {
+        std::unique_ptr<Game> other = Apply(
+            game, {{{f % 5 + 1, f / 5 + 1},
+                    game.At(f % 5 + 1, f / 5 + 1) != Game::State::kBlocked}});
+        EXPECT_EQ(NumStarts(*other), 0) << SaveToHexString(game);
+      }
+    }
+  }
+  EXPECT_GT(num_repaired, 10);
+}
+
+TEST(RepairLayout, Stops) {
+  std::unique_ptr<Game> game = FromMask(1, 3, 0b010);
+  std::vector<LayoutEdit> edits;
+  EXPECT_FALSE(RepairLayout(*game, 3, 1, &edits, [] { return true; }));
+
+  // Stops while solving the first candidate, which would have been a
+  // solution.
+  game = LoadFromHexString("554000000");
+  int num_polls = 0;
+  EXPECT_FALSE(RepairLayout(*game, 3, 1, &edits,
+                            [&num_polls] { return ++num_polls > 1; }));
+  EXPECT_EQ(num_polls, 2);
+  EXPECT_TRUE(RepairLayout(*game, 3, 1, &edits));
+  EXPECT_TRUE(edits.empty());
+}
+
+}  // namespace
+}  // namespace tkware::lightgame
@@ -0,0 +1,153 @@
+// Copyright 2019 by Thomas Köppe
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "game_segments.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "game.h"
+#include "game_bitboard.h"
+#include "game_trace.h"
+
+namespace tkware::lightgame {
+namespace {
+
+using Word = Bitboard::Word;
+using Direction = Bitboard::Direction;
+using State = Bitboard::State;
+
+constexpr int kNumDirections = Bitboard::kNumDirections;
+
+// The losing states are remembered in a direct-mapped table of 2^kMemoBits
+// entries, in which a state replaces whichever state was in its slot. Only
+// states with at least kMinMemoFields open fields are remembered; the search
+// below the others is cheaper than the table lookup.
+constexpr int kMemoBits = 10;
+constexpr int kMinMemoFields = 8;
+
+class SegmentSolver {
+ public:
+  explicit SegmentSolver(const Game& game)
+      : bitboard_(game.Height(), game.Width()),
+        free_(bitboard_.FreeFields(game)) {
+    for (Word fields = free_; fields != 0; fields &= fields - 1) {
+      const int i = __builtin_ctzll(fields);
+      for (int d = 0; d != kNumDirections; ++d) {
+        Word ray = 0;
+        for (Word next = bitboard_.Step(Word{1} << i, Direction(d));
+             (next & free_) != 0; next = bitboard_.Step(next, Direction(d))) {
+          ray |= next;
+        }
+        rays_[i][d] = ray;
+      }
+    }
+  }
+
+  bool Solve(std::vector<int>* solutions) {
+    bool solvable = false;
+    const int stride = bitboard_.Stride();
+    for (Word starts = bitboard_.Starts(free_); starts != 0;
+         starts &= starts - 1) {
+      const int i = __builtin_ctzll(starts);
+      path_.clear();
+      if (!Winnable(Word{1} << i, i)) continue;
+
+      solvable = true;
+      if (solutions == nullptr) break;
+      solutions->push_back(i % stride + 1);
+      solutions->push_back(i / stride + 1);
+      solutions->insert(solutions->end(), path_.begin(), path_.end());
+      solutions->push_back(0);
+    }
+    return solvable;
+  }
+
+ private:
+  // Returns the directions in which a move from pos is possible.
+  unsigned int ValidDirs(Word open, int pos) const {
+    unsigned int dirs = 0;
+    for (int d = 0; d != kNumDirections; ++d) {
+      const Word next = bitboard_.Step(Word{1} << pos, Direction(d));
+      if ((rays_[pos][d] & open & next) != 0) {
+        dirs |= 1U << d;
+      }
+    }
+    return dirs;
+  }
+
+  // Makes the fast action in direction d from *pos, which must be valid.
+  void MoveFast(Word* on, int* pos, Direction d) const {
+    for (;;) {
+      // The move covers the part of the segment ray up to the first field
+      // that is "on". The rays up and left run towards lower bits.
+      const Word ray = rays_[*pos][d];
+      const Word stop = ray & *on;
+      Word moved;
+      if (d == Bitboard::kDown || d == Bitboard::kRight) {
+        moved = stop == 0 ? ray : ray & ((stop & -stop) - 1);
+        *pos = 63 - __builtin_clzll(moved);
+      } else {
+        moved = stop == 0
+                    ? ray
+                    : ray & ~((Word{2} << (63 - __builtin_clzll(stop))) - 1);
+        *pos = __builtin_ctzll(moved);
+      }
+      *on |= moved;
+
+      const unsigned int dirs = ValidDirs(free_ & ~*on, *pos);
+      if (dirs == 0 || (dirs & (dirs - 1)) != 0) return;
+      d = Direction(__builtin_ctz(dirs));
+    }
+  }
+
+  // Returns whether the state can be won, and if so, appends the winning
+  // actions to path_ (the first ones in the order of Game::IsSolvable).
+  bool Winnable(Word on, int pos) {
+    const Word open = free_ & ~on;
+    if (open == 0) return true;
+    const unsigned int dirs = ValidDirs(open, pos);
+    if (dirs == 0 || bitboard_.IsStranded(open, pos)) return false;
+    const bool memo = __builtin_popcountll(open) >= kMinMemoFields;
+    if (memo && losing_.Contains({on, pos})) return false;
+
+    for (int d = 0; d != kNumDirections; ++d) {
+      if ((dirs & (1U << d)) == 0) continue;
+      Word next_on = on;
+      int next_pos = pos;
+      MoveFast(&next_on, &next_pos, Direction(d));
+      path_.push_back(Bitboard::kGameDirs[d]);
+      if (Winnable(next_on, next_pos)) return true;
+      path_.pop_back();
+    }
+
+    if (memo) losing_.Insert({on, pos});
+    return false;
+  }
+
+  const Bitboard bitboard_;
+  const Word free_;
+  Word rays_[64][kNumDirections] = {};
+  std::vector<int> path_;
+  StateMemo losing_{kMemoBits};
+};
+
+}  // namespace
+
+bool SolveBySegments(const Game& game, std::vector<int>* solutions) {
+  LIGHTGAME_TRACE_SCOPE("SolveBySegments");
+  return SegmentSolver(game).Solve(solutions);
+}
+
+}  //  namespace tkware::lightgame
@@ -0,0 +1,46 @@
+// Copyright 2019 by Thomas Köppe
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef H_TKWARE_LIGHTGAME_GAME_SEGMENTS_
+#define H_TKWARE_LIGHTGAME_GAME_SEGMENTS_
+
+#include <vector>
+
+#include "game.h"
+#include "game_bitboard.h"
+
+namespace tkware::lightgame {
+
+// A solver engine for boards of up to 64 fields that works on the segments of
+// the layout rather than on the board. A move always travels along a maximal
+// horizontal or vertical run of free fields (a segment), up to the first field
+// that is already "on", so with the segments precomputed as bit sets, each
+// move is a few mask operations. The search runs over the states (fields that
+// are "on", active field), with the pruning of Game::IsSolvable (on bit sets),
+// and remembers losing states across all starts in a fixed-size table.
+
+// Returns whether layouts of the given size can be solved by segments, which
+// is the case if height * (width + 1) <= 64.
+constexpr bool CanSolveBySegments(int height, int width) {
+  return Bitboard::Fits(height, width);
+}
+
+// Like Game::IsSolvable for the layout of game (ignoring any game in
+// progress), and reports exactly the same solutions. Requires
+// CanSolveBySegments(game.Height(), game.Width()).
+bool SolveBySegments(const Game& game, std::vector<int>* solutions);
+
+}  //  namespace tkware::lightgame
+
+#endif  // H_TKWARE_LIGHTGAME_GAME_SEGMENTS_
@@ -0,0 +1,99 @@
+#include "game_segments.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "game.h"
+#include "gtest/gtest.h"
+
+namespace tkware::lightgame {
+namespace {
+
+// The engines for boards of up to 64 fields. To test another engine, add it
+// to the list at the end.
+struct Engine {
+  const char* name;
+  bool (*can_solve)(int height, int width);
+  bool (*solve)(const Game& game, std::vector<int>* solutions);
+};
+
+class BitboardEngineTest : public testing::TestWithParam<Engine> {
+ protected:
+  void ExpectSameAsGame(Game* game) {
+    const Engine& engine = GetParam();
+    ASSERT_TRUE(engine.can_solve(game->Height(), game->Width()));
+    std::vector<int> expected, actual;
+    ASSERT_EQ(engine.solve(*game, &actual), game->IsSolvable(&expected))
+        << SaveToHexString(*game);
+    EXPECT_EQ(actual, expected) << SaveToHexString(*game);
+    EXPECT_EQ(engine.solve(*game, nullptr), !expected.empty());
+  }
+};
+
+TEST_P(BitboardEngineTest, AllSmallLayouts) {
+  for (auto [h, w] : {std::pair{1, 1}, {1, 5}, {4, 1}, {2, 3}, {3, 3},
+                      {3, 4}, {4, 4}}) {
+    for (std::uint64_t mask = 0; mask != std::uint64_t{1} << (h * w); ++mask) {
+      Game game(h, w);
+      for (int i = 0; i != h * w; ++i) {
+        if ((mask >> i) & 1) game.SetBlocked(i % w + 1, i / w + 1);
+      }
+      ExpectSameAsGame(&game);
+    }
+  }
+}
+
+TEST_P(BitboardEngineTest, RandomLayouts) {
+  std::mt19937 rbg(1001);
+  for (auto [h, w] : {std::pair{5, 5}, {6, 6}, {7, 7}, {8, 7}, {1, 31},
+                      {32, 1}, {3, 15}}) {
+    for (int i = 0; i != 100; ++i) {
+      Game game(h, w);
+      for (int k = 0; k != (h * w) / 8; ++k) {
+        game.SetBlocked(1 + rbg() % w, 1 + rbg() % h);
+      }
+      ExpectSameAsGame(&game);
+    }
+  }
+}
+
+TEST_P(BitboardEngineTest, GoodGames) {
+  for (const char* code : {"6902400412202000", "6914888000000000",
+                           "69000804010a0000", "778011A01203040",
+                           "77180413A400100", "780821248002200C"}) {
+    std::unique_ptr<Game> game = LoadFromHexString(code);
+    ASSERT_NE(game, nullptr);
+    ExpectSameAsGame(game.get());
+  }
+}
+
+TEST_P(BitboardEngineTest, IgnoresGameInProgress) {
+  Game game(2, 3);
+  ASSERT_TRUE(game.Start(1, 1));
+  ASSERT_TRUE(game.Move(Game::kRight));
+  std::vector<int> solutions;
+  EXPECT_TRUE(GetParam().solve(game, &solutions));
+  EXPECT_EQ(std::count(solutions.begin(), solutions.end(), 0), 6);
+  EXPECT_EQ(game.X(), 3);
+}
+
+TEST_P(BitboardEngineTest, Limits) {
+  EXPECT_TRUE(GetParam().can_solve(8, 7));
+  EXPECT_FALSE(GetParam().can_solve(8, 8));
+  EXPECT_FALSE(GetParam().can_solve(3, 0));
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Engines, BitboardEngineTest,
+    testing::Values(
+        Engine{"SolveBySegments", CanSolveBySegments, SolveBySegments}),
+    [](const testing::TestParamInfo<Engine>& info) {
+      return std::string(info.param.name);
+    });
+
+}  // namespace
+}  // namespace tkware::lightgame
@@ -0,0 +1,582 @@
+// Copyright 2019 by Thomas Köppe
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// A headless puzzle service.
+//
+// Usage: game_server [--socket=PATH] [--workers=N] [--batch=N]
+//                    [--deadline_ms=MS]
+//
+// Requests are read line by line, either from stdin (with responses written to
+// stdout), or from any number of clients connected to the Unix domain socket
+// at PATH. Each request has the form "<id> <command> <args...>", where the id
+// is an arbitrary token chosen by the client, and is answered with exactly one
+// response line "<id> ok <result...>", "<id> error <message>" or "<id>
+// timeout". Responses may arrive out of order.
+//
+// Commands:
+//
+//   gen <h> <w> <min> <max>:  a random, solvable layout of dimensions h times w
+//                             with between min and max blocked fields; the
+//                             result is the level code
+//   solve <code>           :  the number of solutions, followed by all
+//                             solutions in the format of Game::IsSolvable
+//   validate <code>        :  "solvable" or "unsolvable"
+//   hint <code>            :  "x y a" for some winning start x, y and the first
+//                             fast action a from there, or "none"
+//   verify <code> <seq...> :  checks candidate solutions in the format of
+//                             Game::IsSolvable ("x y a_1 ... a_N", several of
+//                             them separated by "0"); the result is the
+//                             verdict and step for each of them (see
+//                             game_verify.h), e.g. "win 3" or
+//                             "illegal_move 1"
+//   stats                  :  the queue depth, the number of timeouts, and the
+//                             count and latency percentiles (in microseconds)
+//                             of each command
+//
+// Requests are served by a fixed pool of worker threads, each of which owns
+// its Game instance and keeps the most recently decoded layout, so that
+// consecutive requests for the same level code share it. Consecutive small
+// requests (all but "gen") are dequeued in batches of up to --batch requests
+// at a time; batching only saves taking the queue lock for each of them, and
+// the requests of a batch are still served one by one.
+//
+// Each request has a deadline (--deadline_ms, or a trailing "deadline=<ms>"
+// argument) after which it is answered with "timeout". The deadline is
+// checked when the request is dequeued, and again while it is served: the
+// searches run in slices of kSliceActions fast actions, generation polls it
+// before each attempt, and verification checks it between sequences.
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "game.h"
+#include "game_stats.h"
+#include "game_verify.h"
+
+namespace tkware::lightgame {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// The number of fast actions that a solver runs between deadline checks.
+constexpr std::size_t kSliceActions = 1 << 12;
+
+// A client stream: requests are read from one file descriptor and responses
+// are written to another (which may be the same).
+class Connection {
+ public:
+  Connection(int in_fd, int out_fd, bool owns_fds)
+      : in_fd_(in_fd), out_fd_(out_fd), owns_fds_(owns_fds) {}
+
+  ~Connection() {
+    if (owns_fds_) {
+      close(in_fd_);
+      if (out_fd_ != in_fd_) close(out_fd_);
+    }
+  }
+
+  Connection(const Connection&) = delete;
+  Connection& operator=(const Connection&) = delete;
+
+  // Reads the next line (without the newline). Returns false at the end of the
+  // input. Must only be called from one thread.
+  bool ReadLine(std::string* line) {
+    for (;;) {
+      if (auto pos = buffer_.find('\n'); pos != std::string::npos) {
+        line->assign(buffer_, 0, pos);
+        buffer_.erase(0, pos + 1);
+        return true;
+      }
+      char buf[4096];
+      ssize_t n = read(in_fd_, buf, sizeof buf);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) {
+        // A final line without newline still counts.
+        if (buffer_.empty()) return false;
+        line->swap(buffer_);
+        buffer_.clear();
+        return true;
+      }
+      buffer_.append(buf, n);
+    }
+  }
+
+  // Writes one line; may be called concurrently. Write errors (e.g. from a
+  // client that has gone away) are ignored.
+  void WriteLine(std::string line) {
+    line += '\n';
+    std::lock_guard lock(write_mutex_);
+    for (const char* p = line.data(), *e = p + line.size(); p != e;) {
+      ssize_t n = write(out_fd_, p, e - p);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) return;
+      p += n;
+    }
+  }
+
+ private:
+  const int in_fd_;
+  const int out_fd_;
+  const bool owns_fds_;
+  std::string buffer_;
+  std::mutex write_mutex_;
+};
+
+enum Command {
+  kGenerate = 0,
+  kSolve,
+  kValidate,
+  kHint,
+  kVerify,
+  kNumCommands
+};
+
+constexpr const char* kCommandNames[kNumCommands] = {
+    "gen", "solve", "validate", "hint", "verify"};
+
+struct Request {
+  std::shared_ptr<Connection> connection;
+  std::string id;
+  Command command;
+  std::vector<std::string> args;
+  Clock::time_point arrival;
+  Clock::time_point deadline;
+};
+
+// The state owned by one worker thread. The most recently used layout is kept
+// loaded, so that repeated requests for the same code skip the decoding.
+struct Worker {
+  std::mt19937 rbg{std::random_device{}()};
+  std::string code;
+  std::unique_ptr<Game> game;
+  std::unique_ptr<SolutionVerifier> verifier;  // for game, once needed
+
+  Game* Load(const std::string& new_code) {
+    if (game == nullptr || code != new_code) {
+      game = LoadFromHexString(new_code);
+      verifier.reset();
+      code = new_code;
+    }
+    return game.get();
+  }
+
+  // Requires a loaded game.
+  SolutionVerifier* Verifier() {
+    if (verifier == nullptr) {
+      verifier = std::make_unique<SolutionVerifier>(*game);
+    }
+    return verifier.get();
+  }
+};
+
+// Advances the cursor to its next solution (appending it to *solutions, if
+// not null) in slices, checking the deadline between them. Returns kFound or
+// kDone, or kPaused if the deadline has passed.
+SolutionCursor::Progress AdvanceUntil(SolutionCursor* cursor,
+                                      SolutionSet* solutions,
+                                      Clock::time_point deadline) {
+  for (;;) {
+    const SolutionCursor::Progress progress =
+        cursor->Advance(solutions, kSliceActions);
+    if (progress != SolutionCursor::Progress::kPaused) return progress;
+    if (Clock::now() > deadline) return progress;
+  }
+}
+
+bool ParseInts(const std::vector<std::string>& args, std::vector<int>* out) {
+  for (const std::string& arg : args) {
+    std::istringstream iss(arg);
+    int n;
+    if (!(iss >> n) || !(iss >> std::ws).eof()) return false;
+    out->push_back(n);
+  }
+  return true;
+}
+
+class Server {
+ public:
+  Server(int num_workers, std::size_t batch_size,
+         std::chrono::milliseconds default_deadline)
+      : batch_size_(batch_size), default_deadline_(default_deadline) {
+    for (int i = 0; i != num_workers; ++i) {
+      workers_.emplace_back([this] { WorkerLoop(); });
+    }
+  }
+
+  ~Server() { Shutdown(); }
+
+  // Parses one request line and either enqueues it or, for "stats" and for
+  // malformed requests, answers it right away.
+  void Submit(const std::shared_ptr<Connection>& connection,
+              const std::string& line) {
+    const Clock::time_point now = Clock::now();
+    std::istringstream iss(line);
+    std::string id, command;
+    if (!(iss >> id)) return;  // blank line
+    if (!(iss >> command)) {
+      connection->WriteLine(id + " error missing command");
+      return;
+    }
+
+    if (command == "stats") {
+      connection->WriteLine(id + " ok " + Stats());
+      return;
+    }
+
+    Request request{connection, id, kNumCommands, {}, now,
+                    now + default_deadline_};
+    for (int i = 0; i != kNumCommands; ++i) {
+      if (command == kCommandNames[i]) request.command = Command(i);
+    }
+    if (request.command == kNumCommands) {
+      connection->WriteLine(id + " error unknown command '" + command + "'");
+      return;
+    }
+
+    for (std::string arg; iss >> arg;) {
+      if (arg.rfind("deadline=", 0) == 0) {
+        std::vector<int> ms;
+        if (!ParseInts({arg.substr(9)}, &ms) || ms[0] < 0) {
+          connection->WriteLine(id + " error bad deadline");
+          return;
+        }
+        request.deadline = now + std::chrono::milliseconds(ms[0]);
+      } else {
+        request.args.push_back(std::move(arg));
+      }
+    }
+
+    {
+      std::lock_guard lock(mutex_);
+      queue_.push_back(std::move(request));
+    }
+    cv_.notify_one();
+  }
+
+  // Answers all queued requests and stops the workers.
+  void Shutdown() {
+    {
+      std::lock_guard lock(mutex_);
+      stopping_ = true;
+    }
+    cv_.notify_all();
+    for (std::thread& t : workers_) t.join();
+    workers_.clear();
+  }
+
+ private:
+  static bool IsSmall(const Request& request) {
+    return request.command != kGenerate;
+  }
+
+  void WorkerLoop() {
+    Worker worker;
+    std::vector<Request> batch;
+    for (;;) {
+      {
+        std::unique_lock lock(mutex_);
+        cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+        if (queue_.empty()) return;
+        do {
+          batch.push_back(std::move(queue_.front()));
+          queue_.pop_front();
+        } while (batch.size() < batch_size_ && !queue_.empty() &&
+                 IsSmall(batch.back()) && IsSmall(queue_.front()));
+      }
+      for (const Request& request : batch) Process(&worker, request);
+      batch.clear();
+    }
+  }
+
+  void Process(Worker* worker, const Request& request) {
+    std::string response = Clock::now() > request.deadline
+                               ? "timeout"
+                               : Run(worker, request);
+    request.connection->WriteLine(request.id + " " + response);
+
+    const auto latency = Clock::now() - request.arrival;
+    std::lock_guard lock(stats_mutex_);
+    latencies_[request.command].Record(latency);
+    if (response == "timeout") ++num_timeouts_;
+  }
+
+  std::string Run(Worker* worker, const Request& request) {
+    if (request.command == kGenerate) {
+      std::vector<int> v;
+      if (!ParseInts(request.args, &v) || v.size() != 4) {
+        return "error usage: gen <h> <w> <min> <max>";
+      }
+      const int h = v[0], w = v[1], rmin = v[2], rmax = v[3];
+      if (h < 1 || h > 15 || w < 1 || w > 15) {
+        return "error dimensions must lie in [1, 15]";
+      } else if (rmin < 0 || rmax < rmin || rmax >= h * w) {
+        return "error bad block range";
+      }
+
+      Game game(h, w);
+      const int n = std::uniform_int_distribution(rmin, rmax)(worker->rbg);
+      auto past_deadline = [&request] {
+        return Clock::now() > request.deadline;
+      };
+      if (!game.AugmentRandomly(n, &worker->rbg, past_deadline)) {
+        return "timeout";
+      }
+      return "ok " + SaveToHexString(game);
+    }
+
+    if (request.command == kVerify) {
+      std::vector<int> sequences;
+      if (request.args.empty() ||
+          !ParseInts({request.args.begin() + 1, request.args.end()},
+                     &sequences) ||
+          sequences.empty()) {
+        return "error usage: verify <code> <x> <y> <a_1> ... <a_N>";
+      }
+      if (worker->Load(request.args[0]) == nullptr) return "error bad code";
+      if (sequences.back() != 0) sequences.push_back(0);
+
+      // Each sequence takes time linear in its length, so the deadline is
+      // checked between sequences.
+      std::string response = "ok";
+      for (auto begin = sequences.begin(); begin != sequences.end();) {
+        if (Clock::now() > request.deadline) return "timeout";
+        const auto end = std::find(begin, sequences.end(), 0);
+        const VerifyResult result =
+            worker->Verifier()->Verify(&*begin, &*end);
+        response += std::string(" ") + VerdictName(result.verdict) + " " +
+                    std::to_string(result.step);
+        begin = end + 1;
+      }
+      return response;
+    }
+
+    if (request.args.size() != 1) {
+      return std::string("error usage: ") + kCommandNames[request.command] +
+             " <code>";
+    }
+    Game* game = worker->Load(request.args[0]);
+    if (game == nullptr) return "error bad code";
+
+    SolutionSet solutions;
+    SolutionCursor cursor(*game);
+    switch (request.command) {
+      case kSolve: {
+        for (;;) {
+          const SolutionCursor::Progress progress =
+              AdvanceUntil(&cursor, &solutions, request.deadline);
+          if (progress == SolutionCursor::Progress::kDone) break;
+          if (progress == SolutionCursor::Progress::kPaused) return "timeout";
+        }
+        std::string response = "ok " + std::to_string(solutions.size());
+        for (const SolutionSet::Solution& solution : solutions) {
+          response += " " + std::to_string(solution.Start().x) + " " +
+                      std::to_string(solution.Start().y);
+          for (Game::Dir dir : solution) response += " " + std::to_string(dir);
+          response += " 0";
+        }
+        return response;
+      }
+      case kValidate: {
+        if (std::uint16_t starts; game->LookUpSolvableStarts(&starts)) {
+          return starts != 0 ? "ok solvable" : "ok unsolvable";
+        }
+        switch (AdvanceUntil(&cursor, nullptr, request.deadline)) {
+          case SolutionCursor::Progress::kFound:
+            return "ok solvable";
+          case SolutionCursor::Progress::kDone:
+            return "ok unsolvable";
+          default:
+            return "timeout";
+        }
+      }
+      case kHint: {
+        // Only the first solution is needed.
+        switch (AdvanceUntil(&cursor, &solutions, request.deadline)) {
+          case SolutionCursor::Progress::kDone:
+            return "ok none";
+          case SolutionCursor::Progress::kPaused:
+            return "timeout";
+          default:
+            break;
+        }
+        const SolutionSet::Solution solution = solutions[0];
+        return "ok " + std::to_string(solution.Start().x) + " " +
+               std::to_string(solution.Start().y) + " " +
+               std::to_string(solution.empty() ? 0 : solution[0]);
+      }
+      default:
+        __builtin_unreachable();
+    }
+  }
+
+  std::string Stats() {
+    std::size_t queue_depth;
+    {
+      std::lock_guard lock(mutex_);
+      queue_depth = queue_.size();
+    }
+
+    auto us = [](std::chrono::nanoseconds t) {
+      return std::to_string(t.count() / 1000);
+    };
+
+    std::lock_guard lock(stats_mutex_);
+    std::string s = "queue=" + std::to_string(queue_depth) +
+                    " timeouts=" + std::to_string(num_timeouts_);
+    for (int i = 0; i != kNumCommands; ++i) {
+      const LatencyHistogram& h = latencies_[i];
+      const std::string name = kCommandNames[i];
+      s += " " + name + ".count=" + std::to_string(h.Count()) +
+           " " + name + ".p50=" + us(h.Percentile(50)) +
+           " " + name + ".p90=" + us(h.Percentile(90)) +
+           " " + name + ".p99=" + us(h.Percentile(99)) +
+           " " + name + ".max=" + us(h.Max());
+    }
+    return s;
+  }
+
+  const std::size_t batch_size_;
+  const std::chrono::milliseconds default_deadline_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<Request> queue_;
+  bool stopping_ = false;
+
+  std::mutex stats_mutex_;
+  std::array<LatencyHistogram, kNumCommands> latencies_;
+  std::uint64_t num_timeouts_ = 0;
+
+  std::vector<std::thread> workers_;
+};
+
+void ServeConnection(Server* server, std::shared_ptr<Connection> connection) {
+  for (std::string line; connection->ReadLine(&line);) {
+    server->Submit(connection, line);
+  }
+}
+
+int ServeSocket(Server* server, const std::string& path) {
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof addr.sun_path) {
+    std::cerr << "Socket path too long: " << path << "\n";
+    return 1;
+  }
+  std::strcpy(addr.sun_path, path.c_str());
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  unlink(path.c_str());
+  if (fd < 0 ||
+      bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) != 0 ||
+      listen(fd, SOMAXCONN) != 0) {
+    std::perror(path.c_str());
+    return 1;
+  }
+  std::cerr << "Listening on " << path << "\n";
+
+  for (;;) {
+    int client = accept(fd, nullptr, nullptr);
+    if (client < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) continue;
+      std::perror("accept");
+      return 1;
+    }
+    std::thread(ServeConnection, server,
+                std::make_shared<Connection>(client, client, true))
+        .detach();
+  }
+}
+
+bool ParseFlag(const std::string& arg, const std::string& name,
+               std::string* value) {
+  const std::string prefix = "--" + name + "=";
+  if (arg.rfind(prefix, 0) != 0) return false;
+  *value = arg.substr(prefix.size());
+  return true;
+}
+
+int Run(int argc, char* argv[]) {
+  std::string socket_path;
+  int num_workers = std::max(1U, std::thread::hardware_concurrency());
+  int batch_size = 16;
+  int deadline_ms = 10000;
+
+  for (int i = 1; i != argc; ++i) {
+    std::string value;
+    std::vector<int> n;
+    if (ParseFlag(argv[i], "socket", &value)) {
+      socket_path = value;
+    } else if (ParseFlag(argv[i], "workers", &value) &&
+               ParseInts({value}, &n) && n[0] > 0) {
+      num_workers = n[0];
+    } else if (ParseFlag(argv[i], "batch", &value) &&
+               ParseInts({value}, &n) && n[0] > 0) {
+      batch_size = n[0];
+    } else if (ParseFlag(argv[i], "deadline_ms", &value) &&
+               ParseInts({value}, &n) && n[0] >= 0) {
+      deadline_ms = n[0];
+    } else {
+      std::cerr << "Usage: " << argv[0]
+                << " [--socket=PATH] [--workers=N] [--batch=N]"
+                   " [--deadline_ms=MS]\n";
+      return 1;
+    }
+  }
+
+  std::signal(SIGPIPE, SIG_IGN);
+
+  // The game reports diagnostics on std::cout, which must not end up in the
+  // response stream.
+  std::cout.rdbuf(std::cerr.rdbuf());
+
+  Server server(num_workers, batch_size,
+                std::chrono::milliseconds(deadline_ms));
+  if (!socket_path.empty()) return ServeSocket(&server, socket_path);
+
+  ServeConnection(&server, std::make_shared<Connection>(
+                               STDIN_FILENO, STDOUT_FILENO, false));
+  server.Shutdown();
+  return 0;
+}
+
+}  // namespace
+}  // namespace tkware::lightgame
+
+int main(int argc, char* argv[]) {
+  return tkware::lightgame::Run(argc, argv);
+}
@@ -0,0 +1,308 @@
+// Copyright 2019 by Thomas Köppe
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "game_session.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+
+#include "game.h"
+
+namespace tkware::lightgame {
+namespace {
+
+constexpr char kMagic[4] = {'L', 'G', 'S', '1'};
+
+constexpr std::uint8_t kFastBit = 0x10;
+constexpr std::uint8_t kAcceptedBit = 0x20;
+
+// Layouts with more fields than this are rejected by the reader.
+constexpr std::uint64_t kMaxLayoutFields = std::uint64_t{1} << 24;
+
+// Rendered output is written out whenever this much has accumulated.
+constexpr std::size_t kRenderChunkSize = 1 << 16;
+
+bool IsDir(int dir) {
+  return dir == Game::kUp || dir == Game::kDown || dir == Game::kLeft ||
+         dir == Game::kRight;
+}
+
+}  // namespace
+
+SessionWriter::SessionWriter(std::ostream* out)
+    : out_(out), last_(std::chrono::steady_clock::now()) {
+  out_->write(kMagic, sizeof kMagic);
+}
+
+void SessionWriter::Header(SessionEventType type) {
+  const auto now = std::chrono::steady_clock::now();
+  out_->put(static_cast<char>(type));
+  Varint(std::chrono::duration_cast<std::chrono::microseconds>(now - last_)
+             .count());
+  last_ = now;
+}
+
+void SessionWriter::Varint(std::uint64_t value) {
+  for (; value >= 0x80; value >>= 7) out_->put(static_cast<char>(value | 0x80));
+  out_->put(static_cast<char>(value));
+}
+
+void SessionWriter::Start(const Game& game) {
+  std::string layout(game.LayoutByteSize(8), '\0');
+  game.WriteLayoutAsBits(reinterpret_cast<unsigned char*>(layout.data()), 8);
+  if (game.Height() != height_ || game.Width() != width_ ||
+      layout != layout_) {
+    height_ = game.Height();
+    width_ = game.Width();
+    layout_ = std::move(layout);
+    Header(SessionEventType::kLayout);
+    Varint(height_);
+    Varint(width_);
+    out_->write(layout_.data(), layout_.size());
+  }
+  Header(SessionEventType::kStart);
+  Varint(game.X());
+  Varint(game.Y());
+}
+
+void SessionWriter::Move(const Game& game, Game::Dir dir, bool fast,
+                         bool accepted) {
+  Header(SessionEventType::kMove);
+  out_->put(static_cast<char>(dir | (fast ? kFastBit : 0) |
+                              (accepted ? kAcceptedBit : 0)));
+  if (accepted && game.ValidDirs() == Game::kNone) {
+    Header(SessionEventType::kEnd);
+    out_->put(game.HaveWon() ? 1 : 0);
+    out_->flush();
+  }
+}
+
+void SessionWriter::Reset() { Header(SessionEventType::kReset); }
+
+bool SessionWriter::ok() const { return static_cast<bool>(*out_); }
+
+SessionReader::SessionReader(std::istream* in) : in_(in) {
+  char magic[sizeof kMagic];
+  if (!in_->read(magic, sizeof magic) ||
+      !std::equal(magic, magic + sizeof magic, kMagic)) {
+    Fail("not a session");
+  }
+}
+
+bool SessionReader::Fail(const std::string& message) {
+  if (error_.empty()) {
+    error_ = message + " (at event " + std::to_string(num_events_) + ")";
+  }
+  return false;
+}
+
+bool SessionReader::Byte(std::uint8_t* b) {
+  const int c = in_->get();
+  if (c == std::istream::traits_type::eof()) return Fail("truncated event");
+  *b = static_cast<std::uint8_t>(c);
+  return true;
+}
+
+bool SessionReader::Varint(std::uint64_t* value) {
+  *value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    std::uint8_t b;
+    if (!Byte(&b)) return false;
+    *value |= std::uint64_t{b & 0x7Fu} << shift;
+    if ((b & 0x80) == 0) return true;
+  }
+  return Fail("bad varint");
+}
+
+bool SessionReader::Next(SessionEvent* event) {
+  if (!error_.empty()) return false;
+  const int c = in_->get();
+  if (c == std::istream::traits_type::eof()) return false;
+
+  *event = SessionEvent();
+  event->type = static_cast<SessionEventType>(c);
+  std::uint64_t dt;
+  if (!Varint(&dt)) return false;
+  time_us_ += dt;
+  event->time_us = time_us_;
+
+  std::uint8_t b;
+  std::uint64_t x, y;
+  switch (event->type) {
+    case SessionEventType::kLayout:
+      if (!Varint(&y) || !Varint(&x)) return false;
+      if (x == 0 || y == 0 || x > 0xFFFF || y > 0xFFFF ||
+          x * y > kMaxLayoutFields) {
+        return Fail("bad layout size");
+      }
+      event->height = y;
+      event->width = x;
+      event->layout.resize((x * y + 7) / 8);
+      if (!in_->read(&event->layout[0], event->layout.size())) {
+        return Fail("truncated layout");
+      }
+      break;
+    case SessionEventType::kStart:
+      if (!Varint(&x) || !Varint(&y)) return false;
+      if (x > 0xFFFF || y > 0xFFFF) return Fail("bad start");
+      event->x = x;
+      event->y = y;
+      break;
+    case SessionEventType::kMove:
+      if (!Byte(&b)) return false;
+      if (!IsDir(b & 0x0F) || (b & 0xC0) != 0) return Fail("bad move");
+      event->dir = Game::Dir(b & 0x0F);
+      event->fast = (b & kFastBit) != 0;
+      event->accepted = (b & kAcceptedBit) != 0;
+      break;
+    case SessionEventType::kReset:
+      break;
+    case SessionEventType::kEnd:
+      if (!Byte(&b)) return false;
+      if (b > 1) return Fail("bad end");
+      event->won = b == 1;
+      break;
+    default:
+      return Fail("unknown event type " + std::to_string(c));
+  }
+  ++num_events_;
+  return true;
+}
+
+double ReplayStats::MovesPerSecond() const {
+  return elapsed.count() == 0 ? 0.0 : num_moves * 1e9 / elapsed.count();
+}
+
+ReplayStats ReplaySession(SessionReader* reader, std::ostream* render) {
+  ReplayStats stats;
+  const auto begin = std::chrono::steady_clock::now();
+
+  std::unique_ptr<Game> game;
+  SessionEvent layout;  // the most recent kLayout event
+  std::string output;
+
+  // Sets up a fresh, unstarted game on the most recent layout.
+  auto restore = [&game, &layout] {
+    game = std::make_unique<Game>(layout.height, layout.width);
+    game->LoadLayoutFromBits(
+        reinterpret_cast<const unsigned char*>(layout.layout.data()), 8);
+  };
+
+  auto mismatch = [&stats](const SessionEvent& event, const char* what) {
+    if (stats.num_mismatches++ == 0) {
+      stats.first_error = std::string(what) + " (at event " +
+                          std::to_string(stats.num_events - 1) + ", " +
+                          std::to_string(event.time_us) + " us)";
+    }
+  };
+
+  for (SessionEvent event; reader->Next(&event);) {
+    ++stats.num_events;
+    switch (event.type) {
+      case SessionEventType::kLayout:
+        layout = event;
+        restore();
+        break;
+      case SessionEventType::kStart:
+        ++stats.num_games;
+        if (game == nullptr) {
+          mismatch(event, "start without layout");
+          break;
+        }
+        if (game->HasStarted()) restore();
+        if (!game->Start(event.x, event.y)) mismatch(event, "start failed");
+        break;
+      case SessionEventType::kMove: {
+        ++stats.num_moves;
+        // Rejected moves are checked up front, since Game::Move complains
+        // about them on standard output.
+        const bool accepted =
+            game != nullptr && game->HasStarted() &&
+            (game->ValidDirs() & event.dir) == event.dir &&
+            (event.fast ? game->MoveFast(event.dir) : game->Move(event.dir));
+        if (accepted != event.accepted) mismatch(event, "move differs");
+        break;
+      }
+      case SessionEventType::kReset:
+        if (game != nullptr) game->Reset();
+        break;
+      case SessionEventType::kEnd:
+        if (game == nullptr || !game->HasStarted() ||
+            game->ValidDirs() != Game::kNone) {
+          mismatch(event, "game not over");
+        } else if (game->HaveWon() != event.won) {
+          mismatch(event, "outcome differs");
+        } else {
+          stats.num_wins += event.won;
+        }
+        break;
+    }
+
+    if (render != nullptr && game != nullptr &&
+        event.type != SessionEventType::kEnd) {
+      RenderBoard(*game, &output);
+      if (output.size() >= kRenderChunkSize) {
+        render->write(output.data(), output.size());
+        output.clear();
+      }
+    }
+  }
+  if (!reader->error().empty() && stats.first_error.empty()) {
+    stats.first_error = reader->error();
+  }
+  if (render != nullptr) render->write(output.data(), output.size());
+
+  stats.elapsed = std::chrono::steady_clock::now() - begin;
+  return stats;
+}
+
+void RenderBoard(const Game& game, std::string* out) {
+  auto to_char = [](Game::State s) {
+    switch (s) {
+      case Game::State::kOff:
+        return 'O';
+      case Game::State::kOn:
+        return 'X';
+      case Game::State::kBlocked:
+        return '#';
+      default:
+        return ' ';
+    }
+  };
+
+  std::string rule = "+";
+  for (int x = 1; x <= game.Width(); ++x) rule += "-+";
+  rule += '\n';
+
+  out->reserve(out->size() + (2 * game.Height() + 1) * rule.size());
+  for (int y = 1; y <= game.Height(); ++y) {
+    out->append(rule);
+    out->push_back('|');
+    for (int x = 1; x <= game.Width(); ++x) {
+      out->push_back(x == game.X() && y == game.Y() ? '*'
+                                                    : to_char(game.At(x, y)));
+      out->push_back('|');
+    }
+    out->push_back('\n');
+  }
+  out->append(rule);
+}
+
+}  //  namespace tkware::lightgame
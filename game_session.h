@@ -0,0 +1,144 @@
+// Copyright 2019 by Thomas Köppe
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef H_TKWARE_LIGHTGAME_GAME_SESSION_
+#define H_TKWARE_LIGHTGAME_GAME_SESSION_
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+
+#include "game.h"
+
+namespace tkware::lightgame {
+
+// Recorded play sessions. A session is a sequence of events in a compact
+// binary format: the magic "LGS1", followed by records, each of which is a
+// type byte, the time since the previous record in microseconds (as a
+// LEB128 varint), and a payload:
+//
+//   kLayout:  height and width (varints), followed by the blocked fields as
+//             a bitmask with eight fields per byte, as written by
+//             Game::WriteLayoutAsBits(dst, 8)
+//   kStart:   x and y (varints); only successful starts are recorded
+//   kMove:    one byte: the Dir value, plus 0x10 for a fast action and 0x20
+//             if the move was accepted
+//   kReset:   (nothing)
+//   kEnd:     one byte: 1 if the game was won, 0 if it was lost
+//
+// A start refers to the most recent layout, and each start begins a new game
+// on that layout.
+
+enum class SessionEventType : std::uint8_t {
+  kLayout = 1,
+  kStart = 2,
+  kMove = 3,
+  kReset = 4,
+  kEnd = 5,
+};
+
+struct SessionEvent {
+  SessionEventType type;
+  std::uint64_t time_us;  // since the start of the session
+
+  int height = 0, width = 0;  // kLayout
+  std::string layout;          // kLayout: Game::LayoutByteSize(8) bytes
+  int x = 0, y = 0;            // kStart
+  Game::Dir dir = Game::kNone;  // kMove
+  bool fast = false;            // kMove
+  bool accepted = false;        // kMove
+  bool won = false;             // kEnd
+};
+
+// Appends events to a stream, which must remain valid for the lifetime of the
+// writer. The layout is recorded automatically whenever a game is started on
+// a layout that differs from the last recorded one. The stream is flushed
+// after each completed game.
+class SessionWriter {
+ public:
+  explicit SessionWriter(std::ostream* out);
+
+  // Records a start (which must have succeeded) of the given game.
+  void Start(const Game& game);
+
+  // Records an attempted move, and the end of the game, if it is over.
+  void Move(const Game& game, Game::Dir dir, bool fast, bool accepted);
+
+  void Reset();
+
+  bool ok() const;
+
+ private:
+  void Header(SessionEventType type);
+  void Varint(std::uint64_t value);
+
+  std::ostream* const out_;
+  std::chrono::steady_clock::time_point last_;
+  // The last recorded layout.
+  int height_ = 0, width_ = 0;
+  std::string layout_;
+};
+
+// Reads events from a stream, which must remain valid for the lifetime of the
+// reader.
+class SessionReader {
+ public:
+  explicit SessionReader(std::istream* in);
+
+  // Reads the next event into *event. Returns false at the end of the session
+  // or on error; error() distinguishes the two.
+  bool Next(SessionEvent* event);
+
+  const std::string& error() const { return error_; }
+
+ private:
+  bool Byte(std::uint8_t* b);
+  bool Varint(std::uint64_t* value);
+  bool Fail(const std::string& message);
+
+  std::istream* const in_;
+  std::uint64_t time_us_ = 0;
+  std::uint64_t num_events_ = 0;
+  std::string error_;
+};
+
+struct ReplayStats {
+  std::uint64_t num_events = 0;
+  std::uint64_t num_games = 0;
+  std::uint64_t num_moves = 0;
+  std::uint64_t num_wins = 0;
+  std::uint64_t num_mismatches = 0;  // events that did not replay as recorded
+  std::chrono::nanoseconds elapsed{0};
+
+  // The first mismatch or read error, or empty if there was none.
+  std::string first_error;
+
+  double MovesPerSecond() const;
+};
+
+// Replays a session at full speed, checking that every start, move and game
+// outcome is the same as recorded. If render is not null, the board is
+// rendered after every start, move and reset; the output is buffered and
+// written in large chunks.
+ReplayStats ReplaySession(SessionReader* reader, std::ostream* render);
+
+// Appends a text rendering of the board to *out: "O" for "off", "X" for "on",
+// "#" for blocked fields and "*" for the active field.
+void RenderBoard(const Game& game, std::string* out);
+
+}  //  namespace tkware::lightgame
+
+#endif  // H_TKWARE_LIGHTGAME_GAME_SESSION_
@@ -0,0 +1,189 @@
+#include "game_session.h"
+
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "game.h"
+#include "gtest/gtest.h"
+
+namespace tkware::lightgame {
+namespace {
+
+// Plays a won and a lost game on a 2x3 board, and a game on a second layout.
+std::string RecordSession() {
+  std::ostringstream out;
+  SessionWriter writer(&out);
+
+  Game game(2, 3);
+  EXPECT_TRUE(game.Start(1, 1));
+  writer.Start(game);
+  writer.Move(game, Game::kUp, false, game.Move(Game::kUp));
+  writer.Move(game, Game::kRight, true, game.MoveFast(Game::kRight));
+
+  game.Reset();
+  writer.Reset();
+  EXPECT_TRUE(game.Start(2, 1));
+  writer.Start(game);
+  writer.Move(game, Game::kDown, true, game.MoveFast(Game::kDown));
+  writer.Move(game, Game::kLeft, true, game.MoveFast(Game::kLeft));
+
+  Game other(1, 3);
+  EXPECT_TRUE(other.SetBlocked(2, 1));
+  EXPECT_TRUE(other.Start(1, 1));
+  writer.Start(other);
+  EXPECT_TRUE(writer.ok());
+  return out.str();
+}
+
+TEST(Session, RoundTrip) {
+  std::istringstream in(RecordSession());
+  SessionReader reader(&in);
+  SessionEvent event;
+
+  auto next = [&](SessionEventType type) {
+    ASSERT_TRUE(reader.Next(&event)) << reader.error();
+    ASSERT_EQ(static_cast<int>(event.type), static_cast<int>(type));
+  };
+
+  next(SessionEventType::kLayout);
+  EXPECT_EQ(event.height, 2);
+  EXPECT_EQ(event.width, 3);
+  EXPECT_EQ(event.layout, std::string(1, '\0'));
+  next(SessionEventType::kStart);
+  EXPECT_EQ(event.x, 1);
+  EXPECT_EQ(event.y, 1);
+  next(SessionEventType::kMove);
+  EXPECT_EQ(event.dir, Game::kUp);
+  EXPECT_FALSE(event.fast);
+  EXPECT_FALSE(event.accepted);
+  next(SessionEventType::kMove);
+  EXPECT_EQ(event.dir, Game::kRight);
+  EXPECT_TRUE(event.fast);
+  EXPECT_TRUE(event.accepted);
+  next(SessionEventType::kEnd);
+  EXPECT_TRUE(event.won);
+  next(SessionEventType::kReset);
+  next(SessionEventType::kStart);  // same layout as before
+  next(SessionEventType::kMove);
+  next(SessionEventType::kMove);
+  next(SessionEventType::kEnd);
+  EXPECT_FALSE(event.won);
+  next(SessionEventType::kLayout);
+  EXPECT_EQ(event.height, 1);
+  EXPECT_EQ(event.width, 3);
+  EXPECT_EQ(event.layout, "\x02");
+  next(SessionEventType::kStart);
+
+  EXPECT_FALSE(reader.Next(&event));
+  EXPECT_EQ(reader.error(), "");
+}
+
+TEST(Session, Replay) {
+  std::istringstream in(RecordSession());
+  SessionReader reader(&in);
+  std::ostringstream render;
+  const ReplayStats stats = ReplaySession(&reader, &render);
+  EXPECT_EQ(stats.first_error, "");
+  EXPECT_EQ(stats.num_mismatches, 0);
+  EXPECT_EQ(stats.num_events, 12);
+  EXPECT_EQ(stats.num_games, 3);
+  EXPECT_EQ(stats.num_wins, 1);
+  EXPECT_EQ(stats.num_moves, 4);
+
+  // The last event is the start on the second layout.
+  const std::string last_board = "+-+-+-+\n|*|#|O|\n+-+-+-+\n";
+  EXPECT_EQ(render.str().substr(render.str().size() - last_board.size()),
+            last_board);
+}
+
+TEST(Session, LargeLayout) {
+  // Level codes only cover boards smaller than 16x16; sessions have no limit.
+  Game game(16, 20);
+  EXPECT_TRUE(game.SetBlocked(20, 16));
+  EXPECT_TRUE(game.SetBlocked(3, 1));
+  EXPECT_TRUE(game.Start(1, 1));
+
+  std::ostringstream out;
+  SessionWriter writer(&out);
+  writer.Start(game);
+  writer.Move(game, Game::kLeft, false, false);  // rejected
+  writer.Move(game, Game::kRight, true, game.MoveFast(Game::kRight));
+  writer.Move(game, Game::kDown, true, game.MoveFast(Game::kDown));
+  ASSERT_TRUE(writer.ok());
+  ASSERT_EQ(game.X(), 2);
+  ASSERT_EQ(game.Y(), 16);
+
+  std::istringstream in(out.str());
+  SessionReader reader(&in);
+  std::ostringstream render;
+  testing::internal::CaptureStdout();
+  const ReplayStats stats = ReplaySession(&reader, &render);
+  EXPECT_EQ(testing::internal::GetCapturedStdout(), "");
+  EXPECT_EQ(stats.first_error, "");
+  EXPECT_EQ(stats.num_mismatches, 0);
+  EXPECT_EQ(stats.num_games, 1);
+  EXPECT_EQ(stats.num_moves, 3);
+
+  std::string board;
+  RenderBoard(game, &board);
+  EXPECT_EQ(render.str().substr(render.str().size() - board.size()), board);
+}
+
+TEST(Session, ReplayDetectsMismatches) {
+  std::string session = RecordSession();
+  // Flip the outcome of the first game, which is the first kEnd record.
+  const std::size_t end = session.find('\x05');
+  ASSERT_NE(end, std::string::npos);
+  ASSERT_EQ(session[end + 2], 1);
+  session[end + 2] = 0;
+
+  std::istringstream in(session);
+  SessionReader reader(&in);
+  const ReplayStats stats = ReplaySession(&reader, nullptr);
+  EXPECT_EQ(stats.num_mismatches, 1);
+  EXPECT_EQ(stats.first_error.rfind("outcome differs", 0), 0)
+      << stats.first_error;
+}
+
+TEST(Session, BadInput) {
+  SessionEvent event;
+  {
+    std::istringstream in("LGS2");
+    SessionReader reader(&in);
+    EXPECT_FALSE(reader.Next(&event));
+    EXPECT_NE(reader.error(), "");
+  }
+  {
+    const std::string session = RecordSession();
+    std::istringstream in(session.substr(0, session.size() - 1));
+    SessionReader reader(&in);
+    const ReplayStats stats = ReplaySession(&reader, nullptr);
+    EXPECT_EQ(stats.first_error.rfind("truncated", 0), 0) << stats.first_error;
+  }
+  {
+    std::istringstream in(std::string("LGS1\x03\x00\x07", 7));
+    SessionReader reader(&in);
+    EXPECT_FALSE(reader.Next(&event));
+    EXPECT_EQ(reader.error().rfind("bad move", 0), 0) << reader.error();
+  }
+  {
+    std::istringstream in(std::string("LGS1\x01\x00\x00\x03", 8));
+    SessionReader reader(&in);
+    EXPECT_FALSE(reader.Next(&event));
+    EXPECT_EQ(reader.error().rfind("bad layout size", 0), 0) << reader.error();
+  }
+}
+
+TEST(RenderBoard, Layout) {
+  Game game(2, 2);
+  EXPECT_TRUE(game.SetBlocked(2, 1));
+  EXPECT_TRUE(game.Start(1, 2));
+  EXPECT_TRUE(game.Move(Game::kUp));
+  std::string out = "x";
+  RenderBoard(game, &out);
+  EXPECT_EQ(out, "x+-+-+\n|*|#|\n+-+-+\n|X|O|\n+-+-+\n");
+}
+
+}  // namespace
+}  // namespace tkware::lightgame
@@ -0,0 +1,79 @@
+// Copyright 2019 by Thomas Köppe
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "game_stats.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+namespace tkware::lightgame {
+
+// Values below 2^kSubBucketBits get one bucket each. Above that, each power of
+// two is split into 2^kSubBucketBits buckets, i.e. a bucket is identified by
+// the position of the leading bit and the kSubBucketBits bits following it.
+int LatencyHistogram::BucketFor(std::uint64_t value) {
+  constexpr std::uint64_t kSubBuckets = 1U << kSubBucketBits;
+  if (value < kSubBuckets) return static_cast<int>(value);
+  const int shift = 63 - __builtin_clzll(value) - kSubBucketBits;
+  return static_cast<int>(((shift + 1) << kSubBucketBits) +
+                          ((value >> shift) - kSubBuckets));
+}
+
+// Returns the largest value that falls into the given bucket.
+std::uint64_t LatencyHistogram::ValueFor(int bucket) {
+  constexpr int kSubBuckets = 1 << kSubBucketBits;
+  if (bucket < kSubBuckets) return bucket;
+  const int shift = (bucket >> kSubBucketBits) - 1;
+  const std::uint64_t top = kSubBuckets + (bucket & (kSubBuckets - 1));
+  return ((top + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(std::chrono::nanoseconds latency) {
+  const std::uint64_t value = std::max<std::int64_t>(latency.count(), 0);
+  ++counts_[BucketFor(value)];
+  ++count_;
+  max_ = std::max(max_, latency);
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+  for (int i = 0; i != kNumBuckets; ++i) counts_[i] += other.counts_[i];
+  count_ += other.count_;
+  max_ = std::max(max_, other.max_);
+}
+
+void LatencyHistogram::Clear() {
+  counts_.fill(0);
+  count_ = 0;
+  max_ = std::chrono::nanoseconds(0);
+}
+
+std::chrono::nanoseconds LatencyHistogram::Percentile(double p) const {
+  if (count_ == 0) return std::chrono::nanoseconds(0);
+
+  const auto rank = std::max<std::uint64_t>(
+      1, static_cast<std::uint64_t>(std::ceil(p / 100.0 * count_)));
+  std::uint64_t seen = 0;
+  for (int i = 0; i != kNumBuckets; ++i) {
+    seen += counts_[i];
+    if (seen >= rank) {
+      // The bucket bound may overshoot the largest sample.
+      return std::min(max_, std::chrono::nanoseconds(ValueFor(i)));
+    }
+  }
+  return max_;
+}
+
+}  //  namespace tkware::lightgame
@@ -0,0 +1,60 @@
+// Copyright 2019 by Thomas Köppe
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef H_TKWARE_LIGHTGAME_GAME_STATS_
+#define H_TKWARE_LIGHTGAME_GAME_STATS_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+namespace tkware::lightgame {
+
+// A histogram of latencies with logarithmic buckets, for reporting percentiles
+// of long-running measurements in constant space. Each bucket spans about 3% of
+// its values, so reported percentiles are accurate to that precision. Not
+// thread-safe; use external synchronization or one histogram per thread and
+// Merge.
+class LatencyHistogram {
+ public:
+  void Record(std::chrono::nanoseconds latency);
+
+  // Adds all samples of other to this histogram.
+  void Merge(const LatencyHistogram& other);
+
+  void Clear();
+
+  std::uint64_t Count() const { return count_; }
+  std::chrono::nanoseconds Max() const { return max_; }
+
+  // Returns the smallest recorded bucket value that is at least as large as
+  // the given percentage (in [0, 100]) of all samples, or zero if there are no
+  // samples.
+  std::chrono::nanoseconds Percentile(double p) const;
+
+ private:
+  static constexpr int kSubBucketBits = 5;
+  static constexpr int kNumBuckets = 64 << kSubBucketBits;
+
+  static int BucketFor(std::uint64_t value);
+  static std::uint64_t ValueFor(int bucket);
+
+  std::array<std::uint64_t, kNumBuckets> counts_{};
+  std::uint64_t count_ = 0;
+  std::chrono::nanoseconds max_{0};
+};
+
+}  //  namespace tkware::lightgame
+
+#endif  // H_TKWARE_LIGHTGAME_GAME_STATS_
@@ -0,0 +1,57 @@
+#include "game_stats.h"
+
+#include <chrono>
+
+#include "gtest/gtest.h"
+
+namespace tkware::lightgame {
+namespace {
+
+using std::chrono::nanoseconds;
+
+TEST(LatencyHistogram, Empty) {
+  LatencyHistogram h;
+  EXPECT_EQ(h.Count(), 0);
+  EXPECT_EQ(h.Percentile(50), nanoseconds(0));
+}
+
+TEST(LatencyHistogram, SmallValuesAreExact) {
+  LatencyHistogram h;
+  for (int i = 1; i <= 10; ++i) h.Record(nanoseconds(i));
+  EXPECT_EQ(h.Count(), 10);
+  EXPECT_EQ(h.Percentile(0), nanoseconds(1));
+  EXPECT_EQ(h.Percentile(50), nanoseconds(5));
+  EXPECT_EQ(h.Percentile(90), nanoseconds(9));
+  EXPECT_EQ(h.Percentile(100), nanoseconds(10));
+  EXPECT_EQ(h.Max(), nanoseconds(10));
+}
+
+TEST(LatencyHistogram, LargeValuesAreApproximate) {
+  LatencyHistogram h;
+  for (int i = 1; i <= 1000; ++i) h.Record(nanoseconds(i * 1000));
+  for (double p : {50.0, 99.0, 99.9}) {
+    const double expected = p * 10 * 1000;
+    const double actual = h.Percentile(p).count();
+    EXPECT_GE(actual, expected) << "p" << p;
+    EXPECT_LE(actual, expected * 1.04) << "p" << p;
+  }
+  EXPECT_EQ(h.Percentile(100), nanoseconds(1000000));
+}
+
+TEST(LatencyHistogram, Merge) {
+  LatencyHistogram a, b;
+  a.Record(nanoseconds(3));
+  b.Record(nanoseconds(7));
+  b.Record(nanoseconds(8));
+  a.Merge(b);
+  EXPECT_EQ(a.Count(), 3);
+  EXPECT_EQ(a.Max(), nanoseconds(8));
+  EXPECT_EQ(a.Percentile(50), nanoseconds(7));
+
+  a.Clear();
+  EXPECT_EQ(a.Count(), 0);
+  EXPECT_EQ(a.Max(), nanoseconds(0));
+}
+
+}  // namespace
+}  // namespace tkware::lightgame
@@ -0,0 +1,131 @@
+// Copyright 2019 by Thomas Köppe
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Writes the tables of solvable start fields for all layouts of the small
+// board sizes to standard output, as C++ source that game.cc includes. This
+// program runs as part of the build, so it cannot use the Game class. It has
+// its own plain solver instead, which is slow but simple. As a result, the
+// tables are also an independent check of the solvers.
+
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+// The largest height and width for which tables are made. A layout of up to
+// 16 fields fits in a 16-bit mask.
+constexpr int kMaxSize = 4;
+
+// A board with a border of blocked padding, as in Game, where only the free
+// fields that are still "off" are marked.
+class Board {
+ public:
+  // Bit x - 1 + width * (y - 1) of blocked marks field (x, y) as blocked.
+  Board(int height, int width, unsigned int blocked)
+      : height_(height),
+        width_(width),
+        stride_(width + 2),
+        off_((height + 2) * stride_, false) {
+    for (int i = 0; i != height * width; ++i) {
+      if (((blocked >> i) & 1) == 0) {
+        off_[Index(i)] = true;
+        ++num_free_;
+      }
+    }
+  }
+
+  // Returns the mask of the fields (in the same bit order as the layout) from
+  // which the game can be won.
+  unsigned int SolvableStarts() {
+    unsigned int starts = 0;
+    for (int i = 0; i != height_ * width_; ++i) {
+      const int pos = Index(i);
+      if (!off_[pos]) continue;
+      off_[pos] = false;
+      if (Wins(pos, num_free_ - 1)) starts |= 1U << i;
+      off_[pos] = true;
+    }
+    return starts;
+  }
+
+ private:
+  int Index(int i) const { return i % width_ + 1 + stride_ * (i / width_ + 1); }
+
+  // Returns whether the game can be won with the active field at pos and
+  // num_off fields still "off".
+  bool Wins(int pos, int num_off) {
+    if (num_off == 0) return true;
+    const int offsets[] = {-stride_, +stride_, -1, +1};
+    for (int offset : offsets) {
+      if (!off_[pos + offset]) continue;
+
+      // The fast action: move as far as possible, and keep going for as long
+      // as there is only one way on.
+      std::vector<int> trail;
+      int here = pos;
+      for (int ways = 1; ways == 1;) {
+        while (off_[here + offset]) {
+          here += offset;
+          off_[here] = false;
+          trail.push_back(here);
+        }
+        ways = 0;
+        for (int next : offsets) {
+          if (off_[here + next]) {
+            offset = next;
+            ++ways;
+          }
+        }
+      }
+
+      const bool won = Wins(here, num_off - static_cast<int>(trail.size()));
+      for (int i : trail) off_[i] = true;
+      if (won) return true;
+    }
+    return false;
+  }
+
+  const int height_;
+  const int width_;
+  const int stride_;
+  std::vector<bool> off_;
+  int num_free_ = 0;
+};
+
+}  // namespace
+
+int main() {
+  std::printf("// Generated by game_tables_gen. Do not edit.\n");
+  for (int h = 1; h <= kMaxSize; ++h) {
+    for (int w = 1; w <= kMaxSize; ++w) {
+      std::printf("\nconstexpr std::uint16_t kStarts%dx%d[] = {", h, w);
+      for (unsigned int blocked = 0; blocked != 1U << (h * w); ++blocked) {
+        std::printf(blocked % 10 == 0 ? "\n   " : "");
+        std::printf(" %u,", Board(h, w, blocked).SolvableStarts());
+      }
+      std::printf("\n};\n");
+    }
+  }
+
+  std::printf("\nconstexpr int kMaxTableSize = %d;\n", kMaxSize);
+  std::printf("\nconstexpr const std::uint16_t* kStartTables[][%d] = {\n",
+              kMaxSize);
+  for (int h = 1; h <= kMaxSize; ++h) {
+    std::printf("    {");
+    for (int w = 1; w <= kMaxSize; ++w) {
+      std::printf("kStarts%dx%d%s", h, w, w == kMaxSize ? "},\n" : ", ");
+    }
+  }
+  std::printf("};\n");
+}
@@ -1,8 +1,14 @@
 #include "game.h"
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <memory>
 #include <random>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -66,6 +72,37 @@ TEST(Game, UnsolvableLayout) {
   EXPECT_FALSE(game.IsSolvable(nullptr));
 }
 
+TEST(Game, Stranded) {
+  Game open_game(2, 3);
+  EXPECT_FALSE(open_game.IsStranded());  // no game in progress
+  EXPECT_TRUE(open_game.Start(1, 1));
+  EXPECT_FALSE(open_game.IsStranded());
+  EXPECT_TRUE(open_game.Move(Game::kRight));
+  EXPECT_FALSE(open_game.IsStranded());
+
+  // Two disconnected halves:
+  // +--+--+--+--+--+
+  // |St|  |##|  |  |
+  // +--+--+--+--+--+
+  // |  |  |##|  |  |
+  // +--+--+--+--+--+
+  Game split_game(2, 5);
+  EXPECT_TRUE(split_game.SetBlocked(3, 1));
+  EXPECT_TRUE(split_game.SetBlocked(3, 2));
+  EXPECT_TRUE(split_game.Start(1, 1));
+  EXPECT_TRUE(split_game.IsStranded());
+
+  // The unsolvable layout from above: starting in the centre leaves four dead
+  // ends behind.
+  Game cross_game(3, 3);
+  EXPECT_TRUE(cross_game.SetBlocked(1, 1));
+  EXPECT_TRUE(cross_game.SetBlocked(1, 3));
+  EXPECT_TRUE(cross_game.SetBlocked(3, 1));
+  EXPECT_TRUE(cross_game.SetBlocked(3, 3));
+  EXPECT_TRUE(cross_game.Start(2, 2));
+  EXPECT_TRUE(cross_game.IsStranded());
+}
+
 TEST(Game, InvalidOperations) {
   Game game(2, 3);
   EXPECT_FALSE(game.SetBlocked(3, 3));  // out of bound
@@ -85,6 +122,274 @@ TEST(Game, ValidSolutions) {
   EXPECT_EQ(tracker.TotalCount(), 6);
 }
 
+// The precomputed tables are made by a solver of their own, so they are an
+// oracle for the search.
+TEST(Game, StartTablesMatchSearch) {
+  for (int h = 1; h <= 4; ++h) {
+    for (int w = 1; w <= 4; ++w) {
+      for (unsigned int mask = 0; mask != 1U << (h * w); ++mask) {
+        Game game(h, w);
+        for (int i = 0; i != h * w; ++i) {
+          if ((mask >> i) & 1) game.SetBlocked(i % w + 1, i / w + 1);
+        }
+        std::uint16_t starts;
+        ASSERT_TRUE(game.LookUpSolvableStarts(&starts));
+
+        SolutionSet solutions;
+        SolutionCursor cursor(game);
+        std::uint16_t expected = 0;
+        while (cursor.Next(&solutions)) {
+          const Game::Coord start = solutions[solutions.size() - 1].Start();
+          expected |= 1U << (start.x - 1 + w * (start.y - 1));
+        }
+        ASSERT_EQ(starts, expected) << h << " x " << w << ": "
+                                    << SaveToHexString(game);
+        ASSERT_EQ(game.IsSolvable(nullptr), expected != 0);
+
+        SolutionTracker tracker;
+        tracker.RecomputeFromGame(&game);
+        ASSERT_EQ(tracker.TotalCount(), solutions.size());
+        for (std::size_t i = 0; i != solutions.size(); ++i) {
+          ASSERT_EQ(tracker.AllSolutions()[i], solutions[i].Start());
+        }
+      }
+    }
+  }
+}
+
+TEST(Game, StartTableLimits) {
+  std::uint16_t starts = 0;
+  EXPECT_FALSE(Game(5, 4).LookUpSolvableStarts(&starts));
+  EXPECT_FALSE(Game(4, 5).LookUpSolvableStarts(&starts));
+
+  // The lookup uses the layout, not the game in progress.
+  Game game(2, 3);
+  ASSERT_TRUE(game.Start(1, 1));
+  ASSERT_TRUE(game.Move(Game::kRight));
+  ASSERT_TRUE(game.LookUpSolvableStarts(&starts));
+  EXPECT_EQ(starts, 0b111111);
+  EXPECT_TRUE(game.IsSolvable(nullptr));
+}
+
+TEST(Game, SolvingLeavesGameUnchanged) {
+  Game game(3, 3);
+  game.SetBlocked(2, 2);
+  ASSERT_TRUE(game.Start(1, 1));
+  ASSERT_TRUE(game.Move(Game::kRight));
+  auto fields = [&game] {
+    std::vector<Game::State> states;
+    for (int y = 0; y <= 4; ++y) {
+      for (int x = 0; x <= 4; ++x) states.push_back(game.At(x, y));
+    }
+    return states;
+  };
+  const std::vector<Game::State> before = fields();
+
+  std::vector<int> solutions;
+  EXPECT_TRUE(game.IsSolvable(&solutions));
+  EXPECT_EQ(std::count(solutions.begin(), solutions.end(), 0), 8);
+  EXPECT_EQ(fields(), before);
+  EXPECT_EQ(game.X(), 3);
+  EXPECT_EQ(game.Y(), 1);
+  EXPECT_TRUE(game.Move(Game::kDown));
+  EXPECT_TRUE(game.Move(Game::kLeft));
+}
+
+TEST(Game, ConcurrentSolving) {
+  std::mt19937 rbg(1001);
+  Game game(5, 6);
+  ASSERT_TRUE(game.AugmentRandomly(4, &rbg, [] { return false; }));
+  std::vector<int> expected;
+  ASSERT_TRUE(game.IsSolvable(&expected));
+
+  const Game& shared = game;
+  std::vector<std::vector<int>> results(4);
+  std::vector<std::thread> threads;
+  for (auto& result : results) {
+    threads.emplace_back([&shared, &result] {
+      for (int i = 0; i != 20; ++i) {
+        result.clear();
+        shared.IsSolvable(&result);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  for (const auto& result : results) EXPECT_EQ(result, expected);
+}
+
+TEST(SolutionCursor, MatchesIsSolvable) {
+  std::mt19937 rbg(1001);
+  for (int i = 0; i != 20; ++i) {
+    Game game(5, 6);
+    ASSERT_TRUE(game.AugmentRandomly(4, &rbg, [] { return false; }));
+    std::vector<int> expected, actual;
+    game.IsSolvable(&expected);
+
+    SolutionCursor cursor(game);
+    SolutionSet solutions;
+    std::size_t n = 0;
+    for (; cursor.Next(&solutions); ++n) ASSERT_EQ(solutions.size(), n + 1);
+    EXPECT_FALSE(cursor.Next(&solutions));
+    solutions.AppendToLegacy(&actual);
+    EXPECT_EQ(actual, expected);
+  }
+}
+
+TEST(SolutionCursor, FirstSolution) {
+  // Same layout as in StartAndSolve.
+  Game game(2, 3);
+  SolutionCursor cursor(game);
+  SolutionSet solutions;
+  ASSERT_TRUE(cursor.Next(&solutions));
+  ASSERT_EQ(solutions.size(), 1);
+  EXPECT_EQ(solutions[0].Start(), (Game::Coord{1, 1}));
+  EXPECT_EQ(std::vector<Game::Dir>(solutions[0].begin(), solutions[0].end()),
+            std::vector<Game::Dir>({Game::kDown}));
+}
+
+TEST(SolutionCursor, PausesAndResumes) {
+  std::unique_ptr<Game> game = LoadFromHexString("778011A01203040");
+  ASSERT_NE(game, nullptr);
+  SolutionSet expected, actual;
+  ASSERT_TRUE(game->IsSolvable(&expected));
+
+  SolutionCursor cursor(*game);
+  int num_pauses = 0;
+  for (;;) {
+    const SolutionCursor::Progress progress = cursor.Advance(&actual, 3);
+    if (progress == SolutionCursor::Progress::kDone) break;
+    num_pauses += progress == SolutionCursor::Progress::kPaused;
+  }
+  EXPECT_GT(num_pauses, 0);
+  std::vector<int> lhs, rhs;
+  expected.AppendToLegacy(&lhs);
+  actual.AppendToLegacy(&rhs);
+  EXPECT_EQ(lhs, rhs);
+}
+
+TEST(SolutionCursor, IgnoresGameInProgress) {
+  Game game(2, 3);
+  ASSERT_TRUE(game.Start(1, 1));
+  ASSERT_TRUE(game.Move(Game::kRight));
+  SolutionCursor cursor(game);
+  int n = 0;
+  while (cursor.Next(nullptr)) ++n;
+  EXPECT_EQ(n, 6);
+  EXPECT_EQ(game.X(), 3);
+}
+
+TEST(PaddedBoard, MovesAndUndoes) {
+  // +--+--+--+
+  // |  |  |  |
+  // +--+--+--+
+  // |  |XX|  |
+  // +--+--+--+
+  Game game(2, 3);
+  game.SetBlocked(2, 2);
+  PaddedBoard board(game);
+  const int stride = 5;
+  EXPECT_EQ(board.NumOff(), 5);
+
+  board.Start(1 + stride * 2);
+  EXPECT_EQ(board.ValidDirs(1 + stride * 2), 1U);  // up
+  EXPECT_FALSE(board.IsStranded(1 + stride * 2));
+  const std::size_t length = board.TrailSize();
+  EXPECT_EQ(board.MoveFast(1 + stride * 2, 0), 3 + stride * 2);
+  EXPECT_EQ(board.NumOff(), 0);
+  board.Undo(length);
+  EXPECT_EQ(board.NumOff(), 4);
+  EXPECT_TRUE(board.IsOff(1 + stride));
+  board.Undo(0);
+  EXPECT_EQ(board.NumOff(), 5);
+
+  // From the middle of the top row, both bottom corners are dead ends.
+  board.Start(2 + stride);
+  EXPECT_TRUE(board.IsStranded(2 + stride));
+  EXPECT_EQ(board.Children(2 + stride), 0U);
+
+  // The live board of a game in progress.
+  ASSERT_TRUE(game.Start(2, 1));
+  EXPECT_EQ(PaddedBoard(game, true).NumOff(), 4);
+  EXPECT_EQ(PaddedBoard(game).NumOff(), 5);
+}
+
+TEST(SolutionSet, MatchesLegacyFormat) {
+  std::mt19937 rbg(1001);
+  for (int i = 0; i != 20; ++i) {
+    Game game(5, 6);
+    SolutionSet set;
+    ASSERT_TRUE(game.AugmentRandomly(4, &rbg, [] { return false; }, &set));
+    std::vector<int> legacy;
+    ASSERT_TRUE(game.IsSolvable(&legacy));
+
+    std::vector<int> converted;
+    set.AppendToLegacy(&converted);
+    EXPECT_EQ(converted, legacy);
+
+    SolutionSet parsed;
+    ASSERT_TRUE(parsed.AppendFromLegacy(legacy));
+    ASSERT_EQ(parsed.size(), set.size());
+    for (std::size_t k = 0; k != set.size(); ++k) {
+      EXPECT_EQ(parsed[k].Start(), set[k].Start());
+      EXPECT_TRUE(std::equal(parsed[k].begin(), parsed[k].end(),
+                             set[k].begin(), set[k].end()));
+    }
+    EXPECT_LT(set.ByteSize(), legacy.size() * sizeof(int));
+  }
+}
+
+TEST(SolutionSet, Views) {
+  SolutionSet set;
+  EXPECT_TRUE(set.empty());
+  set.Add({3, 1});
+  for (Game::Dir dir : {Game::kDown, Game::kLeft, Game::kUp, Game::kLeft,
+                        Game::kDown, Game::kRight}) {
+    set.AddMove(dir);
+  }
+  set.Add({1, 1});
+  set.Add({2, 4});
+  set.AddMove(Game::kRight);
+
+  ASSERT_EQ(set.size(), 3);
+  EXPECT_EQ(set[0].Start(), (Game::Coord{3, 1}));
+  EXPECT_THAT(std::vector<Game::Dir>(set[0].begin(), set[0].end()),
+              testing::ElementsAre(Game::kDown, Game::kLeft, Game::kUp,
+                                   Game::kLeft, Game::kDown, Game::kRight));
+  EXPECT_TRUE(set[1].empty());
+  EXPECT_EQ(set[2].size(), 1);
+  EXPECT_EQ(set[2][0], Game::kRight);
+  EXPECT_EQ(std::distance(set.begin(), set.end()), 3);
+
+  std::vector<int> legacy;
+  set.AppendToLegacy(&legacy);
+  EXPECT_THAT(legacy, testing::ElementsAre(3, 1, 2, 4, 1, 4, 2, 8, 0, 1, 1, 0,
+                                           2, 4, 8, 0));
+
+  set.clear();
+  EXPECT_TRUE(set.empty());
+  EXPECT_EQ(set.ByteSize(), 0);
+}
+
+TEST(SolutionSet, RejectsMalformedLegacy) {
+  SolutionSet set;
+  ASSERT_TRUE(set.AppendFromLegacy({1, 1, 8, 0}));
+  const std::vector<std::vector<int>> bad = {
+      {1, 1, 8},       // not terminated
+      {1, 1, 3, 0},    // not a direction
+      {0, 1, 0},       // bad coordinate
+      {2, 1, 0, 1},    // truncated second solution
+  };
+  for (const std::vector<int>& legacy : bad) {
+    EXPECT_FALSE(set.AppendFromLegacy(legacy));
+    std::vector<int> out;
+    set.AppendToLegacy(&out);
+    EXPECT_THAT(out, testing::ElementsAre(1, 1, 8, 0));
+  }
+  set.AddMove(Game::kUp);
+  EXPECT_EQ(set[0].size(), 2);
+  EXPECT_EQ(set[0][1], Game::kUp);
+}
+
 TEST(Game, LoadSave) {
   std::mt19937 rbg(1001);
   Game game(5, 7);
@@ -0,0 +1,175 @@
+// Copyright 2019 by Thomas Köppe
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "game_trace.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace tkware::lightgame {
+namespace {
+
+// Each thread stops recording after this many spans, so that a forgotten
+// trace cannot exhaust memory.
+constexpr std::size_t kMaxSpansPerThread = 1 << 20;
+
+struct Span {
+  const char* name;
+  std::chrono::steady_clock::time_point start, end;
+};
+
+// The spans of one thread. The buffer is shared with the registry, so that it
+// outlives its thread. Its mutex is only ever contended while the trace is
+// written out.
+struct Buffer {
+  std::mutex mu;
+  std::vector<Span> spans;
+  std::uint64_t num_dropped = 0;
+  int tid;
+};
+
+struct Registry {
+  std::mutex mu;
+  std::vector<std::shared_ptr<Buffer>> buffers;
+  std::chrono::steady_clock::time_point epoch =
+      std::chrono::steady_clock::now();
+};
+
+Registry& GetRegistry() {
+  static Registry* const registry = new Registry;
+  return *registry;
+}
+
+Buffer& ThreadBuffer() {
+  thread_local const std::shared_ptr<Buffer> buffer = [] {
+    auto buffer = std::make_shared<Buffer>();
+    Registry& registry = GetRegistry();
+    std::lock_guard lock(registry.mu);
+    buffer->tid = registry.buffers.size() + 1;
+    registry.buffers.push_back(buffer);
+    return buffer;
+  }();
+  return *buffer;
+}
+
+std::string& TracePath() {
+  static std::string* const path = new std::string;
+  return *path;
+}
+
+void WriteTraceAtExit() {
+  if (!WriteTrace(TracePath())) {
+    std::fprintf(stderr, "Failed to write trace to '%s'\n",
+                 TracePath().c_str());
+  }
+}
+
+void WriteJsonString(std::ostream& out, const char* s) {
+  out << '"';
+  for (; *s != '\0'; ++s) {
+    if (*s == '"' || *s == '\\') {
+      out << '\\' << *s;
+    } else if (static_cast<unsigned char>(*s) < 0x20) {
+      out << ' ';
+    } else {
+      out << *s;
+    }
+  }
+  out << '"';
+}
+
+}  // namespace
+
+void EnableTracing(bool enabled) {
+  GetRegistry();  // sets the epoch before the first span starts
+  trace_internal::enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool StartTracingFromEnv() {
+  const char* path = std::getenv("LIGHTGAME_TRACE");
+  if (path == nullptr || *path == '\0') return false;
+  if (TracePath().empty()) std::atexit(WriteTraceAtExit);
+  TracePath() = path;
+  EnableTracing(true);
+  return true;
+}
+
+bool WriteTrace(std::ostream& out) {
+  Registry& registry = GetRegistry();
+  std::lock_guard registry_lock(registry.mu);
+
+  auto micros = [&registry](std::chrono::steady_clock::time_point t) {
+    return std::chrono::duration<double, std::micro>(t - registry.epoch)
+        .count();
+  };
+
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  const char* separator = "\n";
+  for (const std::shared_ptr<Buffer>& buffer : registry.buffers) {
+    std::lock_guard lock(buffer->mu);
+    for (const Span& span : buffer->spans) {
+      out << separator << "{\"name\":";
+      WriteJsonString(out, span.name);
+      out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid
+          << ",\"ts\":" << micros(span.start)
+          << ",\"dur\":" << micros(span.end) - micros(span.start) << "}";
+      separator = ",\n";
+    }
+    if (buffer->num_dropped != 0) {
+      out << separator << "{\"name\":\"dropped spans\",\"ph\":\"C\","
+          << "\"pid\":1,\"tid\":" << buffer->tid << ",\"ts\":0,"
+          << "\"args\":{\"count\":" << buffer->num_dropped << "}}";
+      separator = ",\n";
+    }
+  }
+  out << "\n]}\n";
+  return static_cast<bool>(out);
+}
+
+bool WriteTrace(const std::string& path) {
+  std::ofstream out(path, std::ios::trunc);
+  return out && WriteTrace(out) && out.flush();
+}
+
+void ClearTrace() {
+  Registry& registry = GetRegistry();
+  std::lock_guard registry_lock(registry.mu);
+  for (const std::shared_ptr<Buffer>& buffer : registry.buffers) {
+    std::lock_guard lock(buffer->mu);
+    buffer->spans.clear();
+    buffer->num_dropped = 0;
+  }
+}
+
+void TraceSpan::Record(const char* name,
+                       std::chrono::steady_clock::time_point start,
+                       std::chrono::steady_clock::time_point end) {
+  Buffer& buffer = ThreadBuffer();
+  std::lock_guard lock(buffer.mu);
+  if (buffer.spans.size() < kMaxSpansPerThread) {
+    buffer.spans.push_back({name, start, end});
+  } else {
+    ++buffer.num_dropped;
+  }
+}
+
+}  //  namespace tkware::lightgame
@@ -0,0 +1,100 @@
+// Copyright 2019 by Thomas Köppe
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef H_TKWARE_LIGHTGAME_GAME_TRACE_
+#define H_TKWARE_LIGHTGAME_GAME_TRACE_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+namespace tkware::lightgame {
+
+// A timeline of scoped spans, in the Chrome trace-event format (which can be
+// viewed in chrome://tracing or Perfetto). Spans are recorded into per-thread
+// buffers while tracing is enabled, and written out all at once.
+//
+// Code is instrumented with LIGHTGAME_TRACE_SCOPE("name"), which records a
+// span from that point until the end of the enclosing scope. The name must be
+// a string literal. The macro compiles to nothing unless LIGHTGAME_TRACING is
+// defined (e.g. "make TRACE=1" or "bazel build --config=trace"); the rest of
+// this interface is always available.
+
+// Enables or disables recording of spans. Recorded spans are kept.
+void EnableTracing(bool enabled);
+
+namespace trace_internal {
+inline std::atomic<bool> enabled{false};
+}  // namespace trace_internal
+
+inline bool IsTracingEnabled() {
+  return trace_internal::enabled.load(std::memory_order_relaxed);
+}
+
+// If the environment variable LIGHTGAME_TRACE is set to a path, enables
+// tracing, and arranges for the trace to be written to that path when the
+// program exits. Returns whether tracing was enabled.
+bool StartTracingFromEnv();
+
+// Writes all spans recorded so far as a JSON trace to out, or to the file at
+// path. Returns false on I/O error.
+bool WriteTrace(std::ostream& out);
+bool WriteTrace(const std::string& path);
+
+// Discards all recorded spans.
+void ClearTrace();
+
+// Records a span over its own lifetime, if tracing is enabled when it is
+// constructed. Prefer the macro.
+class TraceSpan {
+ public:
+  explicit TraceSpan(const char* name)
+      : name_(IsTracingEnabled() ? name : nullptr),
+        start_(name_ != nullptr ? std::chrono::steady_clock::now()
+                                : std::chrono::steady_clock::time_point()) {}
+
+  ~TraceSpan() {
+    if (name_ != nullptr) {
+      Record(name_, start_, std::chrono::steady_clock::now());
+    }
+  }
+
+  TraceSpan(const TraceSpan&) = delete;
+  TraceSpan& operator=(const TraceSpan&) = delete;
+
+ private:
+  static void Record(const char* name,
+                     std::chrono::steady_clock::time_point start,
+                     std::chrono::steady_clock::time_point end);
+
+  const char* const name_;
+  const std::chrono::steady_clock::time_point start_;
+};
+
+}  //  namespace tkware::lightgame
+
+#define LIGHTGAME_TRACE_CONCAT_(a, b) a##b
+#define LIGHTGAME_TRACE_CONCAT(a, b) LIGHTGAME_TRACE_CONCAT_(a, b)
+
+#ifdef LIGHTGAME_TRACING
+#define LIGHTGAME_TRACE_SCOPE(name)                    \
+  ::tkware::lightgame::TraceSpan LIGHTGAME_TRACE_CONCAT( \
+      lightgame_trace_span_, __LINE__)(name)
+#else
+#define LIGHTGAME_TRACE_SCOPE(name) static_cast<void>(0)
+#endif
+
+#endif  // H_TKWARE_LIGHTGAME_GAME_TRACE_
@@ -0,0 +1,112 @@
+// Enable the macro regardless of the build configuration.
+#define LIGHTGAME_TRACING 1
+
+#include "game_trace.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace tkware::lightgame {
+namespace {
+
+using ::testing::HasSubstr;
+using ::testing::Not;
+
+std::string TraceString() {
+  std::ostringstream out;
+  EXPECT_TRUE(WriteTrace(out));
+  return out.str();
+}
+
+int CountSpans(const std::string& trace) {
+  int n = 0;
+  for (auto i = trace.find("\"ph\":\"X\""); i != std::string::npos;
+       i = trace.find("\"ph\":\"X\"", i + 1)) {
+    ++n;
+  }
+  return n;
+}
+
+TEST(Trace, DisabledByDefault) {
+  ClearTrace();
+  EXPECT_FALSE(IsTracingEnabled());
+  { LIGHTGAME_TRACE_SCOPE("not recorded"); }
+  EXPECT_EQ(CountSpans(TraceString()), 0);
+  EXPECT_THAT(TraceString(), HasSubstr("\"traceEvents\":["));
+}
+
+TEST(Trace, RecordsNestedSpans) {
+  ClearTrace();
+  EnableTracing(true);
+  {
+    LIGHTGAME_TRACE_SCOPE("outer");
+    for (int i = 0; i != 3; ++i) {
+      LIGHTGAME_TRACE_SCOPE("inner \"quoted\"");
+    }
+  }
+  EnableTracing(false);
+  { LIGHTGAME_TRACE_SCOPE("after"); }
+
+  const std::string trace = TraceString();
+  EXPECT_EQ(CountSpans(trace), 4);
+  EXPECT_THAT(trace, HasSubstr("\"name\":\"outer\""));
+  EXPECT_THAT(trace, HasSubstr("\"name\":\"inner \\\"quoted\\\"\""));
+  EXPECT_THAT(trace, Not(HasSubstr("after")));
+
+  ClearTrace();
+  EXPECT_EQ(CountSpans(TraceString()), 0);
+}
+
+TEST(Trace, SeparatesThreads) {
+  ClearTrace();
+  EnableTracing(true);
+  { LIGHTGAME_TRACE_SCOPE("main thread"); }
+  std::thread([] { LIGHTGAME_TRACE_SCOPE("other thread"); }).join();
+  EnableTracing(false);
+
+  // The spans of a finished thread are kept.
+  const std::string trace = TraceString();
+  EXPECT_EQ(CountSpans(trace), 2);
+  const auto main_span = trace.find("main thread");
+  const auto other_span = trace.find("other thread");
+  ASSERT_NE(main_span, std::string::npos);
+  ASSERT_NE(other_span, std::string::npos);
+  auto tid = [&trace](std::size_t i) {
+    const auto begin = trace.find("\"tid\":", i) + 6;
+    return trace.substr(begin, trace.find(',', begin) - begin);
+  };
+  EXPECT_NE(tid(main_span), tid(other_span));
+}
+
+TEST(Trace, WritesFile) {
+  ClearTrace();
+  EnableTracing(true);
+  { LIGHTGAME_TRACE_SCOPE("to file"); }
+  EnableTracing(false);
+
+  const std::string path = testing::TempDir() + "/game_trace_test.json";
+  ASSERT_TRUE(WriteTrace(path));
+  std::ifstream in(path);
+  std::stringstream contents;
+  contents << in.rdbuf();
+  EXPECT_EQ(contents.str(), TraceString());
+  std::remove(path.c_str());
+
+  EXPECT_FALSE(WriteTrace("/nonexistent/directory/trace.json"));
+}
+
+TEST(Trace, EnvironmentVariableUnset) {
+  unsetenv("LIGHTGAME_TRACE");
+  EXPECT_FALSE(StartTracingFromEnv());
+  EXPECT_FALSE(IsTracingEnabled());
+}
+
+}  // namespace
+}  // namespace tkware::lightgame
@@ -0,0 +1,122 @@
+// Copyright 2019 by Thomas Köppe
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Differential validation of the solver engines.
+//
+// Usage: game_validate [--iterations=N] [--seed=N] [--max_size=N]
+//
+// Generates N random layouts (default 10000) with heights and widths in
+// [1, max_size] (default 8, at most 15) and a range of densities of blocked
+// fields, runs every engine on each of them, and compares the results with
+// those of the frozen reference solver (see game_reference.h). On the first
+// mismatch, the layout is shrunk to a minimal counterexample, whose level code
+// is printed, and the exit status is 1.
+//
+// To validate a new engine, add it to the list in Run().
+
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "game.h"
+#include "game_reference.h"
+#include "game_segments.h"
+
+namespace tkware::lightgame {
+namespace {
+
+struct Engine {
+  std::string name;
+  SolverEngine solve;
+  bool exact_witnesses;  // whether it must report the reference's sequences
+};
+
+bool ParseFlag(const std::string& arg, const std::string& name, int* value) {
+  const std::string prefix = "--" + name + "=";
+  if (arg.rfind(prefix, 0) != 0) return false;
+  std::istringstream iss(arg.substr(prefix.size()));
+  return (iss >> *value) && (iss >> std::ws).eof();
+}
+
+int Run(int argc, char* argv[]) {
+  int iterations = 10000;
+  int seed = 1001;
+  int max_size = 8;
+
+  for (int i = 1; i != argc; ++i) {
+    if (!(ParseFlag(argv[i], "iterations", &iterations) && iterations >= 0) &&
+        !ParseFlag(argv[i], "seed", &seed) &&
+        !(ParseFlag(argv[i], "max_size", &max_size) && 1 <= max_size &&
+          max_size <= 15)) {
+      std::cerr << "Usage: " << argv[0]
+                << " [--iterations=N] [--seed=N] [--max_size=N]\n";
+      return 1;
+    }
+  }
+
+  const std::vector<Engine> engines = {
+      {"Game::IsSolvable",
+       [](Game* game, std::vector<int>* solutions) {
+         return game->IsSolvable(solutions);
+       },
+       true},
+      {"SolveBySegments",
+       [](Game* game, std::vector<int>* solutions) {
+         return CanSolveBySegments(game->Height(), game->Width())
+                    ? SolveBySegments(*game, solutions)
+                    : game->IsSolvable(solutions);
+       },
+       true},
+  };
+
+  std::mt19937 rbg(seed);
+  std::uniform_int_distribution<int> size(1, max_size);
+  std::uniform_int_distribution<int> density(0, 6);
+
+  for (int i = 0; i != iterations; ++i) {
+    const int h = size(rbg), w = size(rbg);
+    std::unique_ptr<Game> game = RandomLayout(h, w, 0.05 * density(rbg), &rbg);
+
+    for (const Engine& engine : engines) {
+      auto mismatch = [&engine](Game* g) {
+        return CompareWithReference(g, engine.solve, engine.exact_witnesses);
+      };
+      if (std::string error = mismatch(game.get()); !error.empty()) {
+        std::unique_ptr<Game> shrunk = ShrinkLayout(
+            *game, [&mismatch](Game* g) { return !mismatch(g).empty(); });
+        std::cout << "Mismatch in " << engine.name << " on layout "
+                  << SaveToHexString(*game) << ": " << error << "\n"
+                  << "Minimal counterexample " << SaveToHexString(*shrunk)
+                  << ": " << mismatch(shrunk.get()) << "\n";
+        return 1;
+      }
+    }
+  }
+
+  std::cout << "Validated " << engines.size() << " engine(s) on "
+            << iterations << " layouts.\n";
+  return 0;
+}
+
+}  // namespace
+}  // namespace tkware::lightgame
+
+int main(int argc, char* argv[]) {
+  return tkware::lightgame::Run(argc, argv);
+}
@@ -0,0 +1,145 @@
+// Copyright 2019 by Thomas Köppe
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "game_verify.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include "game.h"
+
+namespace tkware::lightgame {
+
+const char* VerdictName(Verdict verdict) {
+  switch (verdict) {
+    case Verdict::kWin:
+      return "win";
+    case Verdict::kMalformed:
+      return "malformed";
+    case Verdict::kIllegalStart:
+      return "illegal_start";
+    case Verdict::kIllegalMove:
+      return "illegal_move";
+    case Verdict::kNotFinished:
+      return "not_finished";
+    case Verdict::kLost:
+      return "lost";
+  }
+  return "unknown";
+}
+
+SolutionVerifier::SolutionVerifier(const Game& game)
+    : width_(game.Width()),
+      height_(game.Height()),
+      stride_(game.Width() + 2),
+      blocked_((game.Height() + 2) * stride_, 1),
+      on_(blocked_.size(), 0) {
+  for (int y = 1; y <= height_; ++y) {
+    for (int x = 1; x <= width_; ++x) {
+      if (game.At(x, y) != Game::State::kBlocked) {
+        blocked_[x + stride_ * y] = 0;
+        ++num_free_;
+      }
+    }
+  }
+}
+
+int SolutionVerifier::ValidDirs(int i) const {
+  return (IsOff(i - stride_) ? Game::kUp : 0) |
+         (IsOff(i + stride_) ? Game::kDown : 0) |
+         (IsOff(i - 1) ? Game::kLeft : 0) | (IsOff(i + 1) ? Game::kRight : 0);
+}
+
+VerifyResult SolutionVerifier::Verify(const int* begin, const int* end) {
+  if (end - begin < 2) return {Verdict::kMalformed, 0};
+  const int x = begin[0], y = begin[1];
+  if (x < 1 || x > width_ || y < 1 || y > height_ ||
+      blocked_[x + stride_ * y]) {
+    return {Verdict::kIllegalStart, 0};
+  }
+
+  if (++stamp_ == 0) {
+    std::fill(on_.begin(), on_.end(), 0);
+    stamp_ = 1;
+  }
+  int pos = x + stride_ * y;
+  on_[pos] = stamp_;
+  int num_on = 1;
+
+  int step = 0;
+  for (const int* it = begin + 2; it != end; ++it, ++step) {
+    int offset;
+    switch (*it) {
+      case Game::kUp:
+        offset = -stride_;
+        break;
+      case Game::kDown:
+        offset = +stride_;
+        break;
+      case Game::kLeft:
+        offset = -1;
+        break;
+      case Game::kRight:
+        offset = +1;
+        break;
+      default:
+        return {Verdict::kMalformed, step};
+    }
+    if (!IsOff(pos + offset)) return {Verdict::kIllegalMove, step};
+
+    // The fast action: move as far as possible, and keep going for as long as
+    // there is only one way on.
+    for (;;) {
+      while (IsOff(pos + offset)) {
+        pos += offset;
+        on_[pos] = stamp_;
+        ++num_on;
+      }
+      const int dirs = ValidDirs(pos);
+      if (dirs == Game::kUp) {
+        offset = -stride_;
+      } else if (dirs == Game::kDown) {
+        offset = +stride_;
+      } else if (dirs == Game::kLeft) {
+        offset = -1;
+      } else if (dirs == Game::kRight) {
+        offset = +1;
+      } else {
+        break;
+      }
+    }
+  }
+
+  if (num_on == num_free_) return {Verdict::kWin, step};
+  if (ValidDirs(pos) != 0) return {Verdict::kNotFinished, step};
+  return {Verdict::kLost, step};
+}
+
+std::size_t SolutionVerifier::VerifyAll(const int* begin, const int* end,
+                                        VerifyResult* results,
+                                        std::size_t max_results) {
+  std::size_t n = 0;
+  for (const int* it = begin; it != end; ++n) {
+    // Coordinates are never zero, so the first zero ends the sequence.
+    const int* stop = std::find(it, end, 0);
+    const VerifyResult result =
+        stop == end ? VerifyResult{Verdict::kMalformed, 0} : Verify(it, stop);
+    if (n < max_results) results[n] = result;
+    it = stop == end ? end : stop + 1;
+  }
+  return n;
+}
+
+}  //  namespace tkware::lightgame
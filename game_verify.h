@@ -0,0 +1,89 @@
+// Copyright 2019 by Thomas Köppe
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef H_TKWARE_LIGHTGAME_GAME_VERIFY_
+#define H_TKWARE_LIGHTGAME_GAME_VERIFY_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "game.h"
+
+namespace tkware::lightgame {
+
+enum class Verdict {
+  kWin,          // the sequence wins the game
+  kMalformed,    // the sequence is too short, or an action is not a direction
+  kIllegalStart, // the start is not a field that is "off"
+  kIllegalMove,  // an action points to a field that is not "off"
+  kNotFinished,  // the sequence ends while there are still valid moves
+  kLost,         // the game is over, but not all fields are "on"
+};
+
+struct VerifyResult {
+  Verdict verdict;
+
+  // The index (from zero) of the offending action for kMalformed and
+  // kIllegalMove, and otherwise the number of actions that were made.
+  int step;
+};
+
+const char* VerdictName(Verdict verdict);
+
+// Checks candidate solutions for one layout, in the format of the sequences
+// reported by Game::IsSolvable: "x, y, a_1, a_2, ..., a_N", where the a_i are
+// Dir-valued fast actions. The layout is decoded once on construction; after
+// that, verification performs no I/O and no allocation. A verifier may be
+// reused for any number of sequences, but not concurrently.
+class SolutionVerifier {
+ public:
+  // Uses the layout of the game (ignoring any game in progress).
+  explicit SolutionVerifier(const Game& game);
+
+  // Verifies the sequence in [begin, end). A terminating 0 is not part of the
+  // sequence.
+  VerifyResult Verify(const int* begin, const int* end);
+
+  VerifyResult Verify(const std::vector<int>& sequence) {
+    return Verify(sequence.data(), sequence.data() + sequence.size());
+  }
+
+  // Verifies each sequence of the zero-terminated list of sequences in
+  // [begin, end) (such as the solutions of Game::IsSolvable), and stores the
+  // results of the first max_results of them in results. A trailing sequence
+  // without terminating 0 is kMalformed. Returns the number of sequences.
+  std::size_t VerifyAll(const int* begin, const int* end,
+                        VerifyResult* results, std::size_t max_results);
+
+ private:
+  bool IsOff(int i) const { return !blocked_[i] && on_[i] != stamp_; }
+
+  int ValidDirs(int i) const;
+
+  const int width_;
+  const int height_;
+  const int stride_;
+  int num_free_ = 0;
+
+  // A field is "on" if its entry in on_ equals the current stamp, so that
+  // starting a new verification does not need to clear the board.
+  std::vector<unsigned char> blocked_;
+  std::vector<std::uint32_t> on_;
+  std::uint32_t stamp_ = 0;
+};
+
+}  //  namespace tkware::lightgame
+
+#endif  // H_TKWARE_LIGHTGAME_GAME_VERIFY_
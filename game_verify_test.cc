@@ -0,0 +1,105 @@
+#include "game_verify.h"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "game.h"
+#include "gtest/gtest.h"
+
+namespace tkware::lightgame {
+namespace {
+
+void ExpectResult(const VerifyResult& result, Verdict verdict, int step) {
+  EXPECT_STREQ(VerdictName(result.verdict), VerdictName(verdict));
+  EXPECT_EQ(result.step, step);
+}
+
+TEST(SolutionVerifier, Verdicts) {
+  // +--+--+--+
+  // |  |  |  |
+  // +--+--+--+
+  // |  |##|  |
+  // +--+--+--+
+  // |  |  |  |
+  // +--+--+--+
+  Game game(3, 3);
+  game.SetBlocked(2, 2);
+  SolutionVerifier verifier(game);
+
+  ExpectResult(verifier.Verify({1, 1, Game::kRight}), Verdict::kWin, 1);
+  ExpectResult(verifier.Verify({2, 1, Game::kLeft}), Verdict::kWin, 1);
+  ExpectResult(verifier.Verify({1, 1, Game::kUp}), Verdict::kIllegalMove, 0);
+  ExpectResult(verifier.Verify({1, 1, Game::kRight, Game::kLeft}),
+               Verdict::kIllegalMove, 1);
+  ExpectResult(verifier.Verify({1, 1, 3}), Verdict::kMalformed, 0);
+  ExpectResult(verifier.Verify({1}), Verdict::kMalformed, 0);
+  ExpectResult(verifier.Verify({2, 2, Game::kUp}), Verdict::kIllegalStart, 0);
+  ExpectResult(verifier.Verify({4, 1, Game::kUp}), Verdict::kIllegalStart, 0);
+
+}
+
+TEST(SolutionVerifier, Unfinished) {
+  Game game(2, 3);
+  SolutionVerifier verifier(game);
+
+  // From the middle of a long side, moving across leaves a choice, and
+  // either choice loses.
+  ExpectResult(verifier.Verify({2, 1}), Verdict::kNotFinished, 0);
+  ExpectResult(verifier.Verify({2, 1, Game::kDown}), Verdict::kNotFinished, 1);
+  ExpectResult(verifier.Verify({2, 1, Game::kDown, Game::kLeft}),
+               Verdict::kLost, 2);
+  ExpectResult(verifier.Verify({2, 1, Game::kRight}), Verdict::kWin, 1);
+}
+
+TEST(SolutionVerifier, IgnoresGameInProgress) {
+  Game game(2, 3);
+  ASSERT_TRUE(game.Start(1, 1));
+  ASSERT_TRUE(game.Move(Game::kRight));
+  SolutionVerifier verifier(game);
+  ExpectResult(verifier.Verify({1, 1, Game::kRight}), Verdict::kWin, 1);
+}
+
+TEST(SolutionVerifier, AcceptsAllSolutions) {
+  std::mt19937 rbg(1001);
+  for (int i = 0; i != 50; ++i) {
+    Game game(5, 6);
+    ASSERT_TRUE(game.AugmentRandomly(4, &rbg, [] { return false; }));
+    std::vector<int> solutions;
+    ASSERT_TRUE(game.IsSolvable(&solutions));
+
+    SolutionVerifier verifier(game);
+    std::vector<VerifyResult> results(30);
+    const std::size_t n = verifier.VerifyAll(
+        solutions.data(), solutions.data() + solutions.size(), results.data(),
+        results.size());
+    ASSERT_EQ(n, std::count(solutions.begin(), solutions.end(), 0));
+    for (std::size_t k = 0; k != n; ++k) {
+      EXPECT_EQ(results[k].verdict, Verdict::kWin) << SaveToHexString(game);
+    }
+  }
+}
+
+TEST(SolutionVerifier, VerifyAll) {
+  Game game(2, 3);
+  SolutionVerifier verifier(game);
+  const std::vector<int> sequences = {
+      1, 1, Game::kDown, 0,     // win
+      2, 1, Game::kUp, 0,       // illegal move
+      1, 0,                     // malformed
+      3, 2, Game::kLeft, 0,     // win
+      3, 1, Game::kDown};       // not terminated
+  VerifyResult results[4];
+  EXPECT_EQ(verifier.VerifyAll(sequences.data(),
+                               sequences.data() + sequences.size(), results,
+                               4),
+            5);
+  ExpectResult(results[0], Verdict::kWin, 1);
+  ExpectResult(results[1], Verdict::kIllegalMove, 0);
+  ExpectResult(results[2], Verdict::kMalformed, 0);
+  ExpectResult(results[3], Verdict::kWin, 1);
+}
+
+}  // namespace
+}  // namespace tkware::lightgame
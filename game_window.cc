@@ -16,11 +16,14 @@
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cstddef>
 #include <functional>
 #include <memory>
 #include <random>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <QtCore/QTimer>
 #include <QtGui/QClipboard>
@@ -40,12 +43,31 @@
 #include <QtWidgets/QVBoxLayout>
 #include <QtWidgets/QWidget>
 
+#include "game_repair.h"
 #include "game_tile.h"
+#include "game_trace.h"
 
 namespace tkware::lightgame {
+namespace {
+
+// The number of positions the live analysis may search after each move,
+// which keeps it to a few milliseconds.
+constexpr std::size_t kLiveAnalysisNodes = 1 << 16;
+
+}  // namespace
+
+MainWindow::MainWindow(QWidget* parent, const std::string& pool_path,
+                       const std::string& record_path)
+    : QMainWindow(parent), rbg_(std::random_device{}()), pool_(pool_path) {
+  if (!record_path.empty()) {
+    record_file_.open(record_path, std::ios::binary | std::ios::trunc);
+    if (record_file_) {
+      recorder_ = std::make_unique<SessionWriter>(&record_file_);
+    } else {
+      printf("Cannot record to '%s'\n", record_path.c_str());
+    }
+  }
 
-MainWindow::MainWindow(QWidget* parent)
-    : QMainWindow(parent), rbg_(std::random_device{}()) {
   QWidget* window = new QWidget;
   QHBoxLayout* main_layout = new QHBoxLayout;
   QVBoxLayout* buttons_layout = new QVBoxLayout;
@@ -70,6 +92,7 @@ MainWindow::MainWindow(QWidget* parent)
   QLabel* aug_label = new QLabel("augment count:");
   QLabel* win_label = new QLabel("Victory!");
   QLabel* lose_label = new QLabel("Game over");
+  QLabel* live_label = new QLabel;
   QCheckBox* fast_actions = new QCheckBox("auto-ta&ke actions");
   QHBoxLayout* code_layout = new QHBoxLayout;
   QLabel* code_label = new QLabel("&Code:");
@@ -118,6 +141,9 @@ MainWindow::MainWindow(QWidget* parent)
   lose_label->hide();
   lose_label->setAlignment(Qt::AlignCenter);
   lose_label->setStyleSheet("font-size: 24pt; font-weight: bold; color: #A00;");
+  live_label->hide();
+  live_label->setAlignment(Qt::AlignCenter);
+  live_label->setTextFormat(Qt::RichText);
 
   code_layout->addWidget(code_label);
   code_layout->addWidget(code_edit);
@@ -153,6 +179,7 @@ MainWindow::MainWindow(QWidget* parent)
   buttons_layout->addStretch();
   buttons_layout->addWidget(win_label);
   buttons_layout->addWidget(lose_label);
+  buttons_layout->addWidget(live_label);
   buttons_layout->addStretch();
   buttons_layout->addLayout(meta_layout);
 
@@ -191,9 +218,43 @@ MainWindow::MainWindow(QWidget* parent)
     (quit_button->*mfp)(&key_grabber_);
   };
 
+  // Shows whether the game in progress can still be won, and if hints are
+  // on, in which directions.
+  auto update_live_label = [=]() {
+    LIGHTGAME_TRACE_SCOPE("LiveAnalyzer::Analyze");
+    const LiveAnalysis analysis =
+        analyzer_.Analyze(*game_, kLiveAnalysisNodes);
+    if (!analysis.winnable && !analysis.known) {
+      live_label->setText(
+          "<font color='#888'>Too many possibilities to tell whether this "
+          "game can still be won.</font>");
+    } else if (!analysis.winnable) {
+      live_label->setText(
+          "<font color='#A00'>This game can no longer be won.</font>");
+    } else if (live_hints_) {
+      QString hint = "<font color='#0A0'>Hint:";
+      if (analysis.winning_dirs & Game::kUp) hint.append(" \u2191");
+      if (analysis.winning_dirs & Game::kDown) hint.append(" \u2193");
+      if (analysis.winning_dirs & Game::kLeft) hint.append(" \u2190");
+      if (analysis.winning_dirs & Game::kRight) hint.append(" \u2192");
+      live_label->setText(hint + "</font>");
+    } else {
+      live_label->hide();
+      return;
+    }
+    live_label->show();
+  };
+
   auto handle = [=](int type, int a, int b) {
-    bool (Game::*mover)(Game::Dir, Game::Path*) =
-        fast_actions->isChecked() ? &Game::MoveFast : &Game::Move;
+    LIGHTGAME_TRACE_SCOPE("MainWindow event");
+    const bool fast = fast_actions->isChecked();
+    auto make_move = [=](Game::Dir dir) {
+      const bool accepted =
+          fast ? game_->MoveFast(dir, nullptr) : game_->Move(dir, nullptr);
+      if (recorder_ != nullptr && dir != Game::kNone) {
+        recorder_->Move(*game_, dir, fast, accepted);
+      }
+    };
 
     switch (type) {
       case 1:
@@ -205,18 +266,19 @@ MainWindow::MainWindow(QWidget* parent)
         break;
       case 2:
         if (game_->Start(a, b)) {
+          if (recorder_ != nullptr) recorder_->Start(*game_);
           start_pos_ = {a, b};
           mode_label->hide();
           button1c->setDisabled(true);
           button3->setDisabled(false);
         } else if (a + 1 == game_->X() && b == game_->Y()) {
-          (*game_.*mover)(Game::kLeft, nullptr);
+          make_move(Game::kLeft);
         } else if (a == game_->X() + 1 && b == game_->Y()) {
-          (*game_.*mover)(Game::kRight, nullptr);
+          make_move(Game::kRight);
         } else if (a == game_->X() && b + 1 == game_->Y()) {
-          (*game_.*mover)(Game::kUp, nullptr);
+          make_move(Game::kUp);
         } else if (a == game_->X() && b == game_->Y() + 1) {
-          (*game_.*mover)(Game::kDown, nullptr);
+          make_move(Game::kDown);
         }
         break;
       case 3:
@@ -235,23 +297,28 @@ MainWindow::MainWindow(QWidget* parent)
           }
         };
 
-        (*game_.*mover)(dir_for_key(a), nullptr);
+        make_move(dir_for_key(a));
 
         break;
     }
 
-    for (int y = 0; y != game_->Height(); ++y) {
-      for (int x = 0; x != game_->Width(); ++x) {
-        auto* lbl = board_layout->itemAtPosition(y, x)->widget();
-        assert(lbl != nullptr);
-        auto* p = dynamic_cast<MouseLabel*>(lbl);
-        assert(p != nullptr);
-        p->updateState();
+    {
+      LIGHTGAME_TRACE_SCOPE("MainWindow redraw");
+      for (int y = 0; y != game_->Height(); ++y) {
+        for (int x = 0; x != game_->Width(); ++x) {
+          auto* lbl = board_layout->itemAtPosition(y, x)->widget();
+          assert(lbl != nullptr);
+          auto* p = dynamic_cast<MouseLabel*>(lbl);
+          assert(p != nullptr);
+          p->updateState();
+        }
       }
     }
 
     if (game_->HasStarted()) {
       if (Game::Dir dirs = game_->ValidDirs(); dirs == Game::kNone) {
+        live_label->hide();
+        live_hints_ = false;
         if (game_->HaveWon()) {
           win_label->show();
           if (sol_tracker_.ReportSolution(start_pos_)) {
@@ -262,10 +329,13 @@ MainWindow::MainWindow(QWidget* parent)
         }
       } else {
         set_key_grabbing(true);
+        update_live_label();
       }
     } else {
       win_label->hide();
       lose_label->hide();
+      live_label->hide();
+      live_hints_ = false;
       set_key_grabbing(false);
       code_edit->setText(QString::fromStdString(SaveToHexString(*game_)));
     }
@@ -326,10 +396,10 @@ MainWindow::MainWindow(QWidget* parent)
                   "may block at most %1 fields.").arg(h * w - 1));
       return;
     }
-    game_ = std::make_unique<Game>(h, w);
 
+    // This is instant unless the pool has run dry.
     QApplication::setOverrideCursor(Qt::WaitCursor);
-    game_->AugmentRandomly(std::uniform_int_distribution(rmin, rmax)(rbg_), &rbg_);
+    game_ = pool_.Take({h, w, rmin, rmax}, &rbg_);
     QApplication::restoreOverrideCursor();
     init_grid();
   });
@@ -343,6 +413,7 @@ MainWindow::MainWindow(QWidget* parent)
 
   QObject::connect(button2, &QPushButton::clicked, [=]() {
     if (game_ != nullptr) {
+      if (recorder_ != nullptr && game_->HasStarted()) recorder_->Reset();
       game_->Reset();
       handle(0, 0, 0);
       start_pos_ = {0, 0};
@@ -354,6 +425,7 @@ MainWindow::MainWindow(QWidget* parent)
 
   QObject::connect(button3, &QPushButton::clicked, [=]() {
     if (game_ != nullptr) {
+      if (recorder_ != nullptr && game_->HasStarted()) recorder_->Reset();
       game_->Reset();
       handle(0, 0, 0);
       handle(2, start_pos_.x, start_pos_.y);
@@ -382,15 +454,40 @@ MainWindow::MainWindow(QWidget* parent)
 
   QObject::connect(hint_button, &QPushButton::clicked, [=]() {
     if (game_ == nullptr) return;
-    std::vector<int> s;
+    if (game_->HasStarted() && game_->ValidDirs() != Game::kNone) {
+      live_hints_ = true;
+      update_live_label();
+      return;
+    }
+    SolutionSet s;
     if (!game_->IsSolvable(&s)) {
-      QMessageBox::information(this, "Hint", QString("This layout is not solvable."));
+      // Suggests the fewest tiles to toggle, if there is an answer within a
+      // second.
+      QString text = "This layout is not solvable.";
+      std::vector<LayoutEdit> edits;
+      const auto deadline =
+          std::chrono::steady_clock::now() + std::chrono::seconds(1);
+      QApplication::setOverrideCursor(Qt::WaitCursor);
+      const bool repaired = RepairLayout(*game_, 3, 1, &edits, [deadline] {
+        return std::chrono::steady_clock::now() > deadline;
+      });
+      QApplication::restoreOverrideCursor();
+      if (repaired) {
+        text.append(" It can be made solvable as follows:\n");
+        for (const LayoutEdit& edit : edits) {
+          text.append(QString("\n%1 (%2, %3)")
+                          .arg(edit.block ? "block" : "unblock")
+                          .arg(edit.pos.x)
+                          .arg(edit.pos.y));
+        }
+      }
+      QMessageBox::information(this, "Hint", text);
     } else {
       printf("Solutions:\n");
-      for (auto it = s.begin(); it != s.end(); ++it) {
-        printf("- from (%d, ", *it++);
-        printf("%d) move [ ", *it++);
-        while (*it != 0) printf("%d ", *it++);
+      for (const SolutionSet::Solution& solution : s) {
+        printf("- from (%d, %d) move [ ", solution.Start().x,
+               solution.Start().y);
+        for (Game::Dir dir : solution) printf("%d ", dir);
         printf("]\n");
       }
       // QMessageBox::question(this, "Get hint?", QString("Would you like to spend 75 tkoins for a hint?\n\n(You have 82.25 tkoins at the moment.)"));
@@ -431,7 +528,8 @@ void MainWindow::RedrawStars(QLabel* lbl) {
 
   if (total_count == 0) {
     lbl->setText(QString::fromUtf16(u"<font color='#A00'>\u274C</font>"));
-    lbl->setToolTip("This layout is unsolvable.");
+    lbl->setToolTip(
+        "This layout is unsolvable. The hint button suggests a fix.");
   } else {
     QString star = QString::fromUtf16(u"\u2605");
     QString t = "Found starts:";
@@ -453,6 +551,7 @@ void MainWindow::RedrawStars(QLabel* lbl) {
 }
 
 void MainWindow::RecomputeSolvability() {
+  LIGHTGAME_TRACE_SCOPE("MainWindow::RecomputeSolvability");
   sol_tracker_.RecomputeFromGame(game_.get());
 }
 
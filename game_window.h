@@ -15,13 +15,18 @@
 #ifndef H_TKWARE_LIGHTGAME_GAME_WINDOW_
 #define H_TKWARE_LIGHTGAME_GAME_WINDOW_
 
+#include <fstream>
 #include <memory>
 #include <random>
+#include <string>
 #include <QtWidgets/QLabel>
 #include <QtWidgets/QMainWindow>
 
 #include "game.h"
+#include "game_analysis.h"
 #include "game_keygrabber.h"
+#include "game_pool.h"
+#include "game_session.h"
 
 namespace tkware::lightgame {
 
@@ -32,7 +37,12 @@ class MainWindow : public QMainWindow {
   void gameChanged(int type, int a, int b);
 
  public:
-  explicit MainWindow(QWidget* parent = nullptr);
+  // If pool_path is not empty, the pool of random layouts is kept in the file
+  // at that path across runs. If record_path is not empty, the session is
+  // recorded to the file at that path (see game_session.h).
+  explicit MainWindow(QWidget* parent = nullptr,
+                      const std::string& pool_path = {},
+                      const std::string& record_path = {});
 
  private:
   void RecomputeSolvability();
@@ -42,8 +52,18 @@ class MainWindow : public QMainWindow {
   SolutionTracker sol_tracker_;
   Game::Coord start_pos_;
 
+  // Analyses the game in progress after every move. Once the player asks for
+  // a hint during a game, the winning directions are shown until the game is
+  // over.
+  LiveAnalyzer analyzer_;
+  bool live_hints_ = false;
+
   std::mt19937 rbg_;
+  PuzzlePool pool_;
   KeyGrabber key_grabber_;
+
+  std::ofstream record_file_;
+  std::unique_ptr<SessionWriter> recorder_;
 };
 
 }  //  namespace tkware::lightgame